@@ -0,0 +1,188 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_CONCURRENT_HPP__
+#define __JUDYPP_CONCURRENT_HPP__
+
+#include <judypp/map.hpp>
+#include <judypp/set.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace judypp
+{
+    /*
+     * Read-mostly wrapper publishing immutable snapshots of the container Cont.
+     *
+     * Readers pin the current snapshot by read() and never wait: pinning is an increment of
+     * the counter of their stripe and a load of the pointer. The writer queues changes by
+     * update() and publish() applies all of them to a copy of the current snapshot, swaps it
+     * in and frees the old one after all readers which could see it are gone. Judy arrays
+     * have no shared nodes, so the copy is a full one (the bulk copy of Map/Set), and it is
+     * worth to batch many changes into one publish(). Publishers are serialized by a mutex,
+     * update() does not wait for them.
+     */
+    template <typename Cont>
+    class Concurrent
+    {
+        static const size_t STRIPES = 64;
+
+        // readers in the critical section by parity of the epoch, a line per stripe
+        struct alignas(64) stripe
+        {
+            std::atomic<size_t> n[2];
+
+            stripe() { n[0] = n[1] = 0; }
+        };
+
+        std::atomic<const Cont*> m_Current;
+        std::atomic<size_t> m_Epoch;
+        mutable stripe m_Readers[STRIPES];
+
+        std::mutex m_PublishLock;
+        mutable std::mutex m_QueueLock;
+        std::vector<std::function<void(Cont&)> > m_Pending;
+
+        static size_t thread_stripe()
+        {
+            static std::atomic<size_t> next(0);
+            static thread_local size_t s = next.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+            return s;
+        }
+
+        //! waits for all readers which entered before the call
+        void synchronize()
+        {
+            // a reader may take the parity before the flip and enter after it, so the wait
+            // is done for both parities one after another
+            for (int i = 0; i < 2; ++i)
+            {
+                const size_t e = m_Epoch.fetch_add(1) & 1;
+                for (stripe& r : m_Readers)
+                    while (0 != r.n[e].load())
+                        std::this_thread::yield();
+            }
+        }
+
+    public:
+        typedef Cont container_type;
+
+        //! pinned snapshot, it is valid until the reader is destroyed
+        class reader
+        {
+            std::atomic<size_t>* m_Counter;
+            const Cont* m_Snapshot;
+
+            friend class Concurrent;
+
+            explicit reader(const Concurrent& aOwner)
+            {
+                const size_t e = aOwner.m_Epoch.load() & 1;
+                m_Counter = &aOwner.m_Readers[thread_stripe()].n[e];
+                m_Counter->fetch_add(1);
+                m_Snapshot = aOwner.m_Current.load();
+            }
+
+        public:
+            reader(reader&& r) noexcept : m_Counter(r.m_Counter), m_Snapshot(r.m_Snapshot) { r.m_Counter = NULL; }
+            ~reader()
+            {
+                if (NULL != m_Counter)
+                    m_Counter->fetch_sub(1, std::memory_order_release);
+            }
+
+            reader(const reader&) = delete;
+            reader& operator=(const reader&) = delete;
+            reader& operator=(reader&&) = delete;
+
+            const Cont& operator* () const { return *m_Snapshot; }
+            const Cont* operator-> () const { return m_Snapshot; }
+        };
+
+        Concurrent() : m_Current(new Cont()), m_Epoch(0) {}
+        explicit Concurrent(Cont&& aCont) : m_Current(new Cont(std::move(aCont))), m_Epoch(0) {}
+        //! there must be no readers
+        ~Concurrent() { delete m_Current.load(); }
+
+        Concurrent(const Concurrent&) = delete;
+        Concurrent& operator=(const Concurrent&) = delete;
+
+        //! pins the current snapshot, wait-free
+        reader read() const { return reader(*this); }
+
+        //! queues the change till publish()
+        template <typename F>
+        void update(F&& f)
+        {
+            std::lock_guard<std::mutex> lock(m_QueueLock);
+            m_Pending.emplace_back(std::forward<F>(f));
+        }
+
+        //! applies all queued changes to the copy of the snapshot and makes it current.
+        //! Returns after the old snapshot is freed.
+        void publish()
+        {
+            std::lock_guard<std::mutex> lock(m_PublishLock);
+            std::vector<std::function<void(Cont&)> > changes;
+            {
+                std::lock_guard<std::mutex> queue(m_QueueLock);
+                changes.swap(m_Pending);
+            }
+            if (changes.empty())
+                return;
+
+            std::unique_ptr<Cont> next(new Cont(*m_Current.load()));
+            for (auto& f : changes)
+                f(*next);
+
+            std::unique_ptr<const Cont> old(m_Current.exchange(next.release()));
+            synchronize();
+        }
+
+        //! update(f) and publish()
+        template <typename F>
+        void publish(F&& f)
+        {
+            update(std::forward<F>(f));
+            publish();
+        }
+
+        //! count of queued changes
+        size_t pending() const
+        {
+            std::lock_guard<std::mutex> lock(m_QueueLock);
+            return m_Pending.size();
+        }
+    };
+
+    template <typename Key, typename T>
+    using ConcurrentMap = Concurrent<Map<Key, T> >;
+
+    template <typename Key>
+    using ConcurrentSet = Concurrent<Set<Key> >;
+}// judypp
+
+#endif
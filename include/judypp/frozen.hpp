@@ -0,0 +1,500 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_FROZEN_HPP__
+#define __JUDYPP_FROZEN_HPP__
+
+#include <Judy.h>
+#include <judypp/key_traits.hpp>
+#include <judypp/map.hpp>
+#include <judypp/map_iter.hpp>
+#include <judypp/set.hpp>
+#include <algorithm>
+#include <fcntl.h>
+#include <iterator>
+#include <ostream>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/*
+ * Read-only containers queried in place from a buffer, e.g. a mmap'ed file, or owning
+ * the buffer made by Set::freeze() and Map::freeze().
+ * The frozen format is:
+ *   header (magic, count of keys, words per value: 0 for sets, 1 for maps),
+ *   count encoded keys as words in the Eytzinger order,
+ *   count values as words for maps in the same order.
+ * Words are in the byte order of the host, the buffer must be aligned to the word.
+ *
+ * The Eytzinger order is the breadth-first order of the complete binary search tree, keys
+ * at 1-based positions 2k and 2k + 1 are the children of the key at k. The search goes
+ * down by k = 2k + (key < x) without branches, and the next levels are prefetched while
+ * the current one is compared, so it is faster than the binary search of the sorted array.
+ */
+
+namespace judypp
+{
+    static const char FROZEN_MAGIC[8] = {'J', 'U', 'D', 'Y', 'P', 'P', 'f', 2};
+
+    struct frozen_header
+    {
+        char magic[8];
+        uint64_t count;
+        uint64_t value_words;
+
+        frozen_header(uint64_t aCount, uint64_t aValueWords) : count(aCount), value_words(aValueWords)
+        {
+            memcpy(magic, FROZEN_MAGIC, sizeof(magic));
+        }
+    };
+
+    static const size_t FROZEN_HEADER_WORDS = sizeof(frozen_header) / sizeof(Word_t);
+    static_assert(0 == sizeof(frozen_header) % sizeof(Word_t), "the header must take whole words");
+
+    //! \return pointer to keys of the buffer in the frozen format or NULL if it is not such
+    inline const Word_t* frozen_keys(const void* aData, size_t aSize, uint64_t aValueWords, size_t& aCount)
+    {
+        const frozen_header* h = static_cast<const frozen_header*>(aData);
+        if (aSize < sizeof(*h) || 0 != reinterpret_cast<uintptr_t>(aData) % alignof(Word_t) ||
+                0 != memcmp(h->magic, FROZEN_MAGIC, sizeof(h->magic)) || aValueWords != h->value_words ||
+                h->count > (aSize - sizeof(*h)) / sizeof(Word_t) / (1 + aValueWords))
+            return NULL;
+        aCount = h->count;
+        return reinterpret_cast<const Word_t*>(h + 1);
+    }
+
+    // Positions in the Eytzinger order of n keys are 1-based, 0 is the end
+
+    //! position of the smallest key
+    inline size_t eytzinger_first(size_t n)
+    {
+        if (0 == n)
+            return 0;
+        size_t k = 1;
+        while (2 * k <= n)
+            k *= 2;
+        return k;
+    }
+
+    //! position of the largest key
+    inline size_t eytzinger_last(size_t n)
+    {
+        if (0 == n)
+            return 0;
+        size_t k = 1;
+        while (2 * k + 1 <= n)
+            k = 2 * k + 1;
+        return k;
+    }
+
+    //! the next position in the ascending order
+    inline size_t eytzinger_next(size_t k, size_t n)
+    {
+        if (2 * k + 1 > n)
+            return k >> (__builtin_ctzl(~k) + 1);      // up while k is the right child and once more
+        k = 2 * k + 1;
+        while (2 * k <= n)
+            k *= 2;
+        return k;
+    }
+
+    //! the previous position in the ascending order, the end gives the last one
+    inline size_t eytzinger_prev(size_t k, size_t n)
+    {
+        if (0 == k)
+            return eytzinger_last(n);
+        if (2 * k > n)
+            return k >> (__builtin_ctzl(k) + 1);       // up while k is the left child and once more
+        k = 2 * k;
+        while (2 * k + 1 <= n)
+            k = 2 * k + 1;
+        return k;
+    }
+
+    //! position of the first key >= x (or > x if aUpper is true)
+    inline size_t eytzinger_bound(const Word_t* aKeys, size_t n, Word_t x, bool aUpper)
+    {
+        size_t k = 1;
+        while (k <= n)
+        {
+            // 16 descendants four levels down share a cache line or two
+            if (16 * k <= n)
+                __builtin_prefetch(aKeys + 16 * k - 1);
+            k = 2 * k + (aUpper ? aKeys[k - 1] <= x : aKeys[k - 1] < x);
+        }
+        return k >> __builtin_ffsl(~k);
+    }
+
+    //! Makes the image of the frozen format from keys (and values) given in the ascending order
+    class frozen_writer
+    {
+        std::vector<Word_t> m_Image;
+        size_t m_Count;
+        size_t m_Pos;
+
+    public:
+        frozen_writer(size_t aCount, uint64_t aValueWords)
+            : m_Image(FROZEN_HEADER_WORDS + aCount * (1 + aValueWords)), m_Count(aCount), m_Pos(eytzinger_first(aCount))
+        {
+            const frozen_header h(aCount, aValueWords);
+            memcpy(m_Image.data(), &h, sizeof(h));
+        }
+
+        void add(Word_t aKey)
+        {
+            m_Image[FROZEN_HEADER_WORDS + m_Pos - 1] = aKey;
+            m_Pos = eytzinger_next(m_Pos, m_Count);
+        }
+
+        void add(Word_t aKey, Word_t aValue)
+        {
+            m_Image[FROZEN_HEADER_WORDS + m_Count + m_Pos - 1] = aValue;
+            add(aKey);
+        }
+
+        std::vector<Word_t>& image() { return m_Image; }
+
+        //! \return false if the stream failed
+        bool write(std::ostream& os) const
+        {
+            os.write(reinterpret_cast<const char*>(m_Image.data()), m_Image.size() * sizeof(Word_t));
+            return os.flush().good();
+        }
+    };
+
+    template <typename Key, typename Alloc>
+    frozen_writer frozen_image(const Set<Key, Alloc>& aSet)
+    {
+        frozen_writer w(aSet.size(), 0);
+        aSet.for_each([&] (Key k) { w.add(key_traits<Key>::encode(k)); });
+        return w;
+    }
+
+    template <typename Key, typename T, typename Alloc>
+    frozen_writer frozen_image(const Map<Key, T, Alloc>& aMap)
+    {
+        static_assert(value_storage<T>::inplace, "values out of the slots can not be frozen");
+        frozen_writer w(aMap.size(), 1);
+        aMap.for_each([&] (Key k, const T& v)
+                {
+                    Word_t x = 0;
+                    memcpy(&x, &v, sizeof(T));
+                    w.add(key_traits<Key>::encode(k), x);
+                });
+        return w;
+    }
+
+    //! writes the frozen format by the ordered walk. \return false if the stream failed
+    template <typename Key, typename Alloc>
+    bool save_frozen(const Set<Key, Alloc>& aSet, std::ostream& os) { return frozen_image(aSet).write(os); }
+
+    template <typename Key, typename T, typename Alloc>
+    bool save_frozen(const Map<Key, T, Alloc>& aMap, std::ostream& os) { return frozen_image(aMap).write(os); }
+
+    //! Read-only mapping of the whole file
+    class MappedFile
+    {
+        void* m_Data;
+        size_t m_Size;
+
+    public:
+        MappedFile() : m_Data(NULL), m_Size(0) {}
+        MappedFile(MappedFile&& r) noexcept : m_Data(r.m_Data), m_Size(r.m_Size) { r.m_Data = NULL; r.m_Size = 0; }
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        //! pages are shared with other processes mapping the file. \return false on error (see errno)
+        bool open(const char* aPath)
+        {
+            close();
+            const int fd = ::open(aPath, O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            bool r = 0 == fstat(fd, &st);
+            if (r && 0 != st.st_size)
+            {
+                void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                r = MAP_FAILED != p;
+                if (r)
+                {
+                    m_Data = p;
+                    m_Size = st.st_size;
+                }
+            }
+            ::close(fd);
+            return r;
+        }
+
+        void close()
+        {
+            if (NULL != m_Data)
+                munmap(m_Data, m_Size);
+            m_Data = NULL;
+            m_Size = 0;
+        }
+
+        const void* data() const { return m_Data; }
+        size_t size() const { return m_Size; }
+    };
+
+    // Iterator over keys in the Eytzinger order, values of maps are m_Count words after keys.
+    // m_Pos is the 1-based position of the key, 0 is end()
+    class frozen_iterator_base
+    {
+    protected:
+        const Word_t* m_Keys;
+        size_t m_Count;
+        size_t m_Pos;
+
+    public:
+        frozen_iterator_base(const Word_t* aKeys = NULL, size_t aCount = 0, size_t aPos = 0) : m_Keys(aKeys), m_Count(aCount), m_Pos(aPos) {}
+
+        bool operator == (const frozen_iterator_base& r) const { return m_Pos == r.m_Pos && (0 == m_Pos || m_Keys == r.m_Keys); }
+        bool operator != (const frozen_iterator_base& r) const { return !(*this == r); }
+
+        void operator++ () { m_Pos = eytzinger_next(m_Pos, m_Count); }
+
+        // decrement of end() moves to the last element
+        void operator-- () { m_Pos = eytzinger_prev(m_Pos, m_Count); }
+    };
+
+    template <typename Key>
+    class frozen_set_iterator : public frozen_iterator_base
+    {
+        typedef frozen_set_iterator _Mytype;
+        typedef frozen_iterator_base _Mybase;
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, Key, ptrdiff_t, const Key*, Key> __iter_t;
+        typedef typename __iter_t::value_type           value_type;
+        typedef typename __iter_t::difference_type      difference_type;
+        typedef typename __iter_t::pointer              pointer;
+        typedef typename __iter_t::reference            reference;
+        typedef typename __iter_t::iterator_category    iterator_category;
+
+        frozen_set_iterator(const Word_t* aKeys = NULL, size_t aCount = 0, size_t aPos = 0) : _Mybase(aKeys, aCount, aPos) {}
+
+        _Mytype& operator++ () { _Mybase::operator++(); return *this; }
+        _Mytype operator++ (int) { _Mytype tmp = *this; ++*this; return tmp; }
+        _Mytype& operator-- () { _Mybase::operator--(); return *this; }
+        _Mytype operator-- (int) { _Mytype tmp = *this; --*this; return tmp; }
+
+        reference operator* () const { return key_traits<Key>::decode(this->m_Keys[this->m_Pos - 1]); }
+    };
+
+    template <typename Key, typename T>
+    class frozen_map_iterator : public frozen_iterator_base
+    {
+        typedef frozen_map_iterator _Mytype;
+        typedef frozen_iterator_base _Mybase;
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, std::pair<const Key, const T&>, ptrdiff_t,
+                map_arrow_proxy<std::pair<const Key, const T&> >, std::pair<const Key, const T&> > __iter_t;
+        typedef typename __iter_t::value_type           value_type;
+        typedef typename __iter_t::difference_type      difference_type;
+        typedef typename __iter_t::pointer              pointer;
+        typedef typename __iter_t::reference            reference;
+        typedef typename __iter_t::iterator_category    iterator_category;
+
+        frozen_map_iterator(const Word_t* aKeys = NULL, size_t aCount = 0, size_t aPos = 0) : _Mybase(aKeys, aCount, aPos) {}
+
+        _Mytype& operator++ () { _Mybase::operator++(); return *this; }
+        _Mytype operator++ (int) { _Mytype tmp = *this; ++*this; return tmp; }
+        _Mytype& operator-- () { _Mybase::operator--(); return *this; }
+        _Mytype operator-- (int) { _Mytype tmp = *this; --*this; return tmp; }
+
+        reference operator* () const
+        {
+            return reference(key_traits<Key>::decode(this->m_Keys[this->m_Pos - 1]),
+                    value_storage<T>::ref(const_cast<PWord_t>(this->m_Keys + this->m_Count + this->m_Pos - 1)));
+        }
+
+        pointer operator-> () const { return pointer{**this}; }
+    };
+
+    /*
+     * Keys of frozen containers: the view of the buffer in the frozen format or the own image.
+     * Copies of the own image are deep, moves keep the buffer.
+     */
+    class frozen_storage
+    {
+    protected:
+        std::vector<Word_t> m_Image;
+        const Word_t* m_Keys;
+        size_t m_Size;
+
+        frozen_storage() : m_Keys(NULL), m_Size(0) {}
+        frozen_storage(const frozen_storage& r)
+            : m_Image(r.m_Image), m_Keys(m_Image.empty() ? r.m_Keys : m_Image.data() + FROZEN_HEADER_WORDS), m_Size(r.m_Size) {}
+        frozen_storage(frozen_storage&& r) noexcept : m_Image(std::move(r.m_Image)), m_Keys(r.m_Keys), m_Size(r.m_Size)
+        {
+            r.m_Keys = NULL;
+            r.m_Size = 0;
+        }
+        frozen_storage& operator=(const frozen_storage& r)
+        {
+            if (&r != this)
+            {
+                frozen_storage tmp(r);
+                swap(tmp);
+            }
+            return *this;
+        }
+        frozen_storage& operator=(frozen_storage&& r) noexcept
+        {
+            swap(r);
+            return *this;
+        }
+
+        void swap(frozen_storage& r) noexcept
+        {
+            m_Image.swap(r.m_Image);
+            std::swap(m_Keys, r.m_Keys);
+            std::swap(m_Size, r.m_Size);
+        }
+
+        bool view(const void* aData, size_t aSize, uint64_t aValueWords)
+        {
+            size_t n = 0;
+            const Word_t* k = frozen_keys(aData, aSize, aValueWords, n);
+            if (NULL == k)
+                return false;
+            if (aData != m_Image.data())
+                std::vector<Word_t>().swap(m_Image);
+            m_Keys = k;
+            m_Size = n;
+            return true;
+        }
+
+        void adopt(std::vector<Word_t>& aImage, uint64_t aValueWords)
+        {
+            m_Image.swap(aImage);
+            view(m_Image.data(), m_Image.size() * sizeof(Word_t), aValueWords);
+        }
+
+        //! position of the key or 0
+        size_t position(Word_t x) const
+        {
+            const size_t k = eytzinger_bound(m_Keys, m_Size, x, false);
+            return 0 != k && m_Keys[k - 1] == x ? k : 0;
+        }
+
+    public:
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        //! bytes of the own image, 0 for the view of a buffer
+        size_t memory_usage() const { return m_Image.capacity() * sizeof(Word_t); }
+    };
+
+    //! Read-only set over the buffer in the frozen format or over its own image
+    template <typename Key>
+    class FrozenSet : public frozen_storage
+    {
+        typedef key_traits<Key> traits;
+
+        template <typename K, typename A> friend class Set;
+
+    public:
+        typedef Key key_type;
+        typedef Key value_type;
+        typedef frozen_set_iterator<Key> const_iterator;
+
+        //! \return false if the buffer is not in the frozen format of a set, the buffer must outlive the set
+        bool open(const void* aData, size_t aSize) { return view(aData, aSize, 0); }
+
+        bool test(key_type key) const { return 0 != position(traits::encode(key)); }
+
+        const_iterator begin() const { return const_iterator(m_Keys, m_Size, eytzinger_first(m_Size)); }
+        const_iterator end() const { return const_iterator(m_Keys, m_Size); }
+
+        const_iterator find(const key_type& k) const { return const_iterator(m_Keys, m_Size, position(traits::encode(k))); }
+
+        const_iterator lower_bound(const key_type& k) const { return const_iterator(m_Keys, m_Size, eytzinger_bound(m_Keys, m_Size, traits::encode(k), false)); }
+        const_iterator upper_bound(const key_type& k) const { return const_iterator(m_Keys, m_Size, eytzinger_bound(m_Keys, m_Size, traits::encode(k), true)); }
+    };
+
+    //! Read-only map over the buffer in the frozen format or over its own image
+    template <typename Key, typename T>
+    class FrozenMap : public frozen_storage
+    {
+        typedef key_traits<Key> traits;
+        typedef value_storage<T> storage;
+
+        template <typename K, typename V, typename A> friend class Map;
+
+    public:
+        static_assert(storage::inplace, "values must be kept in words");
+
+        typedef Key key_type;
+        typedef T mapped_type;
+        typedef frozen_map_iterator<Key, T> const_iterator;
+
+        //! \return false if the buffer is not in the frozen format of a map, the buffer must outlive the map
+        bool open(const void* aData, size_t aSize) { return view(aData, aSize, 1); }
+
+        //! \return pointer to the value or NULL
+        const mapped_type* get(key_type key) const
+        {
+            const size_t k = position(traits::encode(key));
+            return 0 == k ? NULL : &storage::ref(const_cast<PWord_t>(m_Keys + m_Size + k - 1));
+        }
+
+        const_iterator begin() const { return const_iterator(m_Keys, m_Size, eytzinger_first(m_Size)); }
+        const_iterator end() const { return const_iterator(m_Keys, m_Size); }
+
+        const_iterator find(const key_type& k) const { return const_iterator(m_Keys, m_Size, position(traits::encode(k))); }
+
+        const_iterator lower_bound(const key_type& k) const { return const_iterator(m_Keys, m_Size, eytzinger_bound(m_Keys, m_Size, traits::encode(k), false)); }
+        const_iterator upper_bound(const key_type& k) const { return const_iterator(m_Keys, m_Size, eytzinger_bound(m_Keys, m_Size, traits::encode(k), true)); }
+    };
+
+    template <typename Key, typename Alloc>
+    FrozenSet<Key> Set<Key, Alloc>::freeze() const
+    {
+        std::vector<Word_t> image;
+        image.swap(frozen_image(*this).image());
+        FrozenSet<Key> r;
+        r.adopt(image, 0);
+        return r;
+    }
+
+    template <typename Key, typename T, typename Alloc>
+    FrozenMap<Key, T> Map<Key, T, Alloc>::freeze() const
+    {
+        std::vector<Word_t> image;
+        image.swap(frozen_image(*this).image());
+        FrozenMap<Key, T> r;
+        r.adopt(image, 1);
+        return r;
+    }
+}// judypp
+
+#endif
@@ -0,0 +1,643 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+
+#ifndef __JUDYPP_HYBRID_SET_HPP__
+#define __JUDYPP_HYBRID_SET_HPP__
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_pointer.hpp>
+#include <Judy.h>
+#include <judypp/key_traits.hpp>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace judypp
+{
+    /*
+     * Set of 16-bit values in one of three forms, whichever is the smallest for its content:
+     *   ARRAY  - sorted values, 2 bytes per value, at most ARRAY_MAX of them
+     *   BITMAP - 1024 words, 8 KB for any count
+     *   RUN    - sorted runs of consecutive values, 4 bytes per run
+     * The count of runs is kept by every form, so the choice is made after each change in
+     * O(1). A form is left only when another one is twice smaller, so alternating set and
+     * unset near the bound do not convert the chunk back and forth.
+     */
+    class hybrid_chunk
+    {
+    public:
+        enum kind_t { ARRAY, BITMAP, RUN };
+
+        static const uint32_t ARRAY_MAX = 4096;
+        static const uint32_t BITMAP_WORDS = 1024;
+
+        hybrid_chunk() : m_Kind(ARRAY), m_Count(0), m_RunCount(0) {}
+
+        kind_t kind() const { return m_Kind; }
+        uint32_t size() const { return m_Count; }
+
+        //! bytes taken from the heap
+        size_t bytes() const
+        {
+            return sizeof(*this) + m_Values.capacity() * sizeof(uint16_t) + m_Bits.capacity() * sizeof(uint64_t)
+                + m_Runs.capacity() * sizeof(run);
+        }
+
+        bool test(uint32_t x) const
+        {
+            switch (m_Kind)
+            {
+            case ARRAY:
+                return std::binary_search(m_Values.begin(), m_Values.end(), uint16_t(x));
+            case BITMAP:
+                return (m_Bits[x / 64] >> (x % 64)) & 1;
+            default:
+                {
+                    std::vector<run>::const_iterator r = run_of(x);
+                    return r != m_Runs.end() && x <= r->last;
+                }
+            }
+        }
+
+        //! \return true if x is new
+        bool set(uint32_t x)
+        {
+            if (test(x))
+                return false;
+            const bool left = 0 != x && test(x - 1), right = 0xffff != x && test(x + 1);
+            switch (m_Kind)
+            {
+            case ARRAY:
+                m_Values.insert(std::lower_bound(m_Values.begin(), m_Values.end(), uint16_t(x)), uint16_t(x));
+                break;
+            case BITMAP:
+                m_Bits[x / 64] |= uint64_t(1) << (x % 64);
+                break;
+            default:
+                {
+                    // the run before x if any, x is not in it
+                    std::vector<run>::iterator r = m_Runs.begin() + (run_of(x) - m_Runs.begin());
+                    std::vector<run>::iterator next = r == m_Runs.end() ? m_Runs.begin() : r + 1;
+                    if (left && right)
+                    {
+                        r->last = next->last;
+                        m_Runs.erase(next);
+                    }
+                    else if (left)
+                    {
+                        r->last = x;
+                    }
+                    else if (right)
+                    {
+                        next->first = x;
+                    }
+                    else
+                    {
+                        m_Runs.insert(next, run{uint16_t(x), uint16_t(x)});
+                    }
+                }
+            }
+            ++m_Count;
+            m_RunCount += 1 - left - right;
+            adapt();
+            return true;
+        }
+
+        //! \return true if x was present
+        bool unset(uint32_t x)
+        {
+            if (!test(x))
+                return false;
+            const bool left = 0 != x && test(x - 1), right = 0xffff != x && test(x + 1);
+            switch (m_Kind)
+            {
+            case ARRAY:
+                m_Values.erase(std::lower_bound(m_Values.begin(), m_Values.end(), uint16_t(x)));
+                break;
+            case BITMAP:
+                m_Bits[x / 64] &= ~(uint64_t(1) << (x % 64));
+                break;
+            default:
+                {
+                    std::vector<run>::iterator r = m_Runs.begin() + (run_of(x) - m_Runs.begin());
+                    if (left && right)
+                    {
+                        const run tail = {uint16_t(x + 1), r->last};
+                        r->last = x - 1;
+                        m_Runs.insert(r + 1, tail);
+                    }
+                    else if (left)
+                    {
+                        r->last = x - 1;
+                    }
+                    else if (right)
+                    {
+                        r->first = x + 1;
+                    }
+                    else
+                    {
+                        m_Runs.erase(r);
+                    }
+                }
+            }
+            --m_Count;
+            m_RunCount += left + right - 1;
+            adapt();
+            return true;
+        }
+
+        //! the smallest value >= x or -1
+        int32_t next(uint32_t x) const
+        {
+            if (x > 0xffff)
+                return -1;
+            switch (m_Kind)
+            {
+            case ARRAY:
+                {
+                    std::vector<uint16_t>::const_iterator i = std::lower_bound(m_Values.begin(), m_Values.end(), uint16_t(x));
+                    return i == m_Values.end() ? -1 : *i;
+                }
+            case BITMAP:
+                {
+                    uint32_t w = x / 64;
+                    uint64_t bits = m_Bits[w] & (~uint64_t(0) << (x % 64));
+                    while (0 == bits)
+                    {
+                        if (++w == BITMAP_WORDS)
+                            return -1;
+                        bits = m_Bits[w];
+                    }
+                    return w * 64 + __builtin_ctzll(bits);
+                }
+            default:
+                {
+                    std::vector<run>::const_iterator r = run_of(x);
+                    if (r != m_Runs.end() && x <= r->last)
+                        return x;
+                    r = r == m_Runs.end() ? m_Runs.begin() : r + 1;
+                    return r == m_Runs.end() ? -1 : r->first;
+                }
+            }
+        }
+
+        //! the largest value <= x or -1
+        int32_t prev(uint32_t x) const
+        {
+            x = std::min<uint32_t>(x, 0xffff);
+            switch (m_Kind)
+            {
+            case ARRAY:
+                {
+                    std::vector<uint16_t>::const_iterator i = std::upper_bound(m_Values.begin(), m_Values.end(), uint16_t(x));
+                    return i == m_Values.begin() ? -1 : *--i;
+                }
+            case BITMAP:
+                {
+                    uint32_t w = x / 64;
+                    uint64_t bits = m_Bits[w] & (~uint64_t(0) >> (63 - x % 64));
+                    while (0 == bits)
+                    {
+                        if (0 == w--)
+                            return -1;
+                        bits = m_Bits[w];
+                    }
+                    return w * 64 + 63 - __builtin_clzll(bits);
+                }
+            default:
+                {
+                    std::vector<run>::const_iterator r = run_of(x);
+                    return r == m_Runs.end() ? -1 : std::min<uint32_t>(x, r->last);
+                }
+            }
+        }
+
+    private:
+        struct run
+        {
+            uint16_t first;
+            uint16_t last;
+        };
+
+        kind_t m_Kind;
+        uint32_t m_Count;
+        uint32_t m_RunCount;
+        std::vector<uint16_t> m_Values;     // ARRAY
+        std::vector<uint64_t> m_Bits;       // BITMAP
+        std::vector<run> m_Runs;            // RUN
+
+        //! the last run starting at or before x, end() if there is no such
+        std::vector<run>::const_iterator run_of(uint32_t x) const
+        {
+            std::vector<run>::const_iterator r = std::upper_bound(m_Runs.begin(), m_Runs.end(), x,
+                    [] (uint32_t v, const run& a) { return v < a.first; });
+            return r == m_Runs.begin() ? m_Runs.end() : r - 1;
+        }
+
+        void adapt()
+        {
+            if (0 == m_Count)
+                return;
+            const size_t array = m_Count <= ARRAY_MAX ? m_Count * sizeof(uint16_t) : size_t(-1);
+            const size_t bitmap = BITMAP_WORDS * sizeof(uint64_t);
+            const size_t runs = m_RunCount * sizeof(run);
+            switch (m_Kind)
+            {
+            case ARRAY:
+                if (m_Count > ARRAY_MAX)
+                    convert(runs < bitmap ? RUN : BITMAP);
+                else if (2 * runs <= array)
+                    convert(RUN);
+                break;
+            case BITMAP:
+                if (2 * runs <= bitmap)
+                    convert(RUN);
+                else if (2 * array <= bitmap)
+                    convert(ARRAY);
+                break;
+            default:
+                if (runs > 2 * std::min(array, bitmap))
+                    convert(array <= bitmap ? ARRAY : BITMAP);
+            }
+        }
+
+        void convert(kind_t aKind)
+        {
+            std::vector<uint16_t> values;
+            values.reserve(m_Count);
+            for (int32_t x = next(0); x >= 0; x = next(x + 1))
+                values.push_back(uint16_t(x));
+
+            std::vector<uint16_t>().swap(m_Values);
+            std::vector<uint64_t>().swap(m_Bits);
+            std::vector<run>().swap(m_Runs);
+            m_Kind = aKind;
+            switch (aKind)
+            {
+            case ARRAY:
+                m_Values.swap(values);
+                break;
+            case BITMAP:
+                m_Bits.assign(BITMAP_WORDS, 0);
+                for (uint16_t x : values)
+                    m_Bits[x / 64] |= uint64_t(1) << (x % 64);
+                break;
+            default:
+                m_Runs.reserve(m_RunCount);
+                for (uint16_t x : values)
+                    if (m_Runs.empty() || m_Runs.back().last + 1 != x)
+                        m_Runs.push_back(run{x, x});
+                    else
+                        m_Runs.back().last = x;
+            }
+        }
+    };
+
+    // Iterator over HybridSet: JudyL index of the chunk and the value in it, m_Chunk == NULL
+    // means end(). Any insertion or deletion invalidates it.
+    template <typename Key>
+    class hybrid_set_const_iterator
+    {
+        typedef hybrid_set_const_iterator _Mytype;
+
+        static const unsigned LOW_BITS = 16;
+
+        Pcvoid_t m_Array;
+        Word_t m_High;
+        const hybrid_chunk* m_Chunk;
+        uint32_t m_Low;
+
+        //! the chunk from the slot of JudyL, NULL slot gives end()
+        void enter(PPvoid_t v, bool aForward)
+        {
+            m_Chunk = NULL == v ? NULL : static_cast<const hybrid_chunk*>(*v);
+            if (NULL != m_Chunk)
+                m_Low = aForward ? m_Chunk->next(0) : m_Chunk->prev(0xffff);
+        }
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, const Key, ptrdiff_t, void, Key> __iter_t;
+        typedef typename __iter_t::value_type           value_type;
+        typedef typename __iter_t::difference_type      difference_type;
+        typedef typename __iter_t::pointer              pointer;
+        typedef typename __iter_t::reference            reference;
+        typedef typename __iter_t::iterator_category    iterator_category;
+
+        // like from end()
+        hybrid_set_const_iterator(Pcvoid_t aArray = NULL) : m_Array(aArray), m_High(0), m_Chunk(NULL), m_Low(0) {}
+
+        //! the first key >= aIndex, or aIndex only if aExact is true
+        hybrid_set_const_iterator(Pcvoid_t aArray, Word_t aIndex, bool aExact) : m_Array(aArray), m_High(aIndex >> LOW_BITS), m_Chunk(NULL), m_Low(0)
+        {
+            const Word_t high = m_High;
+            PPvoid_t v = JudyLFirst(m_Array, &m_High, PJE0);
+            if (NULL != v && high == m_High)
+            {
+                const int32_t low = static_cast<const hybrid_chunk*>(*v)->next(aIndex & 0xffff);
+                if (low >= 0)
+                {
+                    m_Chunk = static_cast<const hybrid_chunk*>(*v);
+                    m_Low = low;
+                }
+                else
+                {
+                    enter(JudyLNext(m_Array, &m_High, PJE0), true);
+                }
+            }
+            else
+            {
+                enter(v, true);
+            }
+
+            if (aExact && NULL != m_Chunk && ((m_High << LOW_BITS) | m_Low) != aIndex)
+                m_Chunk = NULL;
+        }
+
+        bool operator == (const _Mytype& r) const
+        {
+            if (NULL == m_Chunk || NULL == r.m_Chunk)
+                return m_Chunk == r.m_Chunk;
+            return m_Array == r.m_Array && m_High == r.m_High && m_Low == r.m_Low;
+        }
+
+        bool operator != (const _Mytype& r) const { return !(*this == r); }
+
+        _Mytype& operator++ ()
+        {
+            const int32_t low = m_Chunk->next(m_Low + 1);
+            if (low >= 0)
+                m_Low = low;
+            else
+                enter(JudyLNext(m_Array, &m_High, PJE0), true);
+            return *this;
+        }
+
+        _Mytype operator++ (int)
+        {
+            _Mytype tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        //! decrement of end() moves to the last key
+        _Mytype& operator-- ()
+        {
+            if (NULL == m_Chunk)
+            {
+                m_High = -1;
+                enter(JudyLLast(m_Array, &m_High, PJE0), false);
+                return *this;
+            }
+            const int32_t low = 0 == m_Low ? -1 : m_Chunk->prev(m_Low - 1);
+            if (low >= 0)
+                m_Low = low;
+            else
+                enter(JudyLPrev(m_Array, &m_High, PJE0), false);
+            return *this;
+        }
+
+        _Mytype operator-- (int)
+        {
+            _Mytype tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        reference operator* () const
+        {
+            return key_traits<Key>::decode((m_High << LOW_BITS) | m_Low);
+        }
+    };
+
+    /*
+     * Set in the style of Roaring bitmaps: JudyL by the high bits of the key holds chunks of
+     * 2^16 keys, every chunk is a sorted array, a bitmap or runs (see hybrid_chunk) and
+     * changes its form by its density. Dense ranges take about a bit per key or less,
+     * sparse keys 2 bytes plus the share of the chunk.
+     *
+     * Key must be an integral type with sizeof(Key) <= sizeof(Word_t)
+     */
+    template <typename Key>
+    class HybridSet
+    {
+        static const unsigned LOW_BITS = 16;
+
+        Pvoid_t m_Array;
+        size_t m_Size;
+
+        typedef key_traits<Key> traits;
+
+    public:
+        BOOST_STATIC_ASSERT(sizeof(Key) <= sizeof(Word_t));
+        BOOST_STATIC_ASSERT(boost::is_integral<Key>::value || boost::is_pointer<Key>::value);
+
+        typedef Key key_type;
+        typedef Key value_type;
+
+        typedef hybrid_set_const_iterator<Key> const_iterator;
+
+        HybridSet() : m_Array(NULL), m_Size(0) {}
+        HybridSet(const HybridSet& aSet) : HybridSet() { copy(aSet); }
+        HybridSet(HybridSet&& aSet) noexcept : m_Array(aSet.m_Array), m_Size(aSet.m_Size)
+        {
+            aSet.m_Array = NULL;
+            aSet.m_Size = 0;
+        }
+        ~HybridSet() { clear(); }
+        HybridSet& operator=(const HybridSet& aSet)
+        {
+            if (&aSet != this)
+            {
+                clear();
+                copy(aSet);
+            }
+            return *this;
+        }
+        HybridSet& operator=(HybridSet&& aSet) noexcept
+        {
+            if (&aSet != this)
+            {
+                clear();
+                swap(aSet);
+            }
+            return *this;
+        }
+
+        void swap(HybridSet& aSet) noexcept
+        {
+            std::swap(m_Array, aSet.m_Array);
+            std::swap(m_Size, aSet.m_Size);
+        }
+
+        //! returns true if the key is new
+        bool set(key_type key)
+        {
+            const Word_t i = traits::encode(key);
+            PPvoid_t v = JudyLIns(&m_Array, i >> LOW_BITS, PJE0);
+            hybrid_chunk* c = static_cast<hybrid_chunk*>(*v);
+            bool r;
+            try
+            {
+                if (NULL == c)
+                    *v = c = new hybrid_chunk;
+                r = c->set(i & 0xffff);
+            }
+            catch (...)
+            {
+                // no slot is left without a chunk or with the empty one
+                if (NULL == c || 0 == c->size())
+                {
+                    delete c;
+                    JudyLDel(&m_Array, i >> LOW_BITS, PJE0);
+                }
+                throw;
+            }
+            m_Size += r;
+            return r;
+        }
+
+        //! returns true if the key was present, empty chunks are freed
+        bool unset(key_type key)
+        {
+            const Word_t i = traits::encode(key);
+            PPvoid_t v = JudyLGet(m_Array, i >> LOW_BITS, PJE0);
+            if (NULL == v)
+                return false;
+            hybrid_chunk* c = static_cast<hybrid_chunk*>(*v);
+            bool r = c->unset(i & 0xffff);
+            m_Size -= r;
+            if (0 == c->size())
+            {
+                delete c;
+                JudyLDel(&m_Array, i >> LOW_BITS, PJE0);
+            }
+            return r;
+        }
+
+        bool test(key_type key) const
+        {
+            const Word_t i = traits::encode(key);
+            PPvoid_t v = JudyLGet(m_Array, i >> LOW_BITS, PJE0);
+            return NULL != v && static_cast<const hybrid_chunk*>(*v)->test(i & 0xffff);
+        }
+
+        //! O(1), population is maintained by set/unset/clear
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        //! bytes occupied by the Judy array and chunks
+        size_t memory_usage() const
+        {
+            size_t bytes = JudyLMemUsed(m_Array);
+            Word_t i = 0;
+            for (PPvoid_t v = JudyLFirst(m_Array, &i, PJE0); NULL != v; v = JudyLNext(m_Array, &i, PJE0))
+                bytes += static_cast<const hybrid_chunk*>(*v)->bytes();
+            return bytes;
+        }
+
+        //! count of chunks of the kind
+        size_t chunks(hybrid_chunk::kind_t aKind) const
+        {
+            size_t n = 0;
+            Word_t i = 0;
+            for (PPvoid_t v = JudyLFirst(m_Array, &i, PJE0); NULL != v; v = JudyLNext(m_Array, &i, PJE0))
+                n += aKind == static_cast<const hybrid_chunk*>(*v)->kind();
+            return n;
+        }
+
+        void clear()
+        {
+            Word_t i = 0;
+            for (PPvoid_t v = JudyLFirst(m_Array, &i, PJE0); NULL != v; v = JudyLNext(m_Array, &i, PJE0))
+                delete static_cast<hybrid_chunk*>(*v);
+            JudyLFreeArray(&m_Array, PJE0);
+            m_Size = 0;
+        }
+
+        // --- std::set interface ---
+
+        bool insert(const value_type& v) { return set(v); }
+
+        //! return count of erased keys (0 or 1)
+        size_t erase(const key_type& k) { return unset(k); }
+
+        const_iterator begin() const { return const_iterator(m_Array, 0, false); }
+        const_iterator end()   const { return const_iterator(m_Array); }
+
+        const_iterator find(const key_type& k) const { return const_iterator(m_Array, traits::encode(k), true); }
+
+        //! first key >= k
+        const_iterator lower_bound(const key_type& k) const { return const_iterator(m_Array, traits::encode(k), false); }
+
+        //! first key > k
+        const_iterator upper_bound(const key_type& k) const
+        {
+            const Word_t i = traits::encode(k);
+            return Word_t(-1) == i ? end() : const_iterator(m_Array, i + 1, false);
+        }
+
+    private:
+        //! chunks are copied in order and the index is built bottom-up
+        void copy(const HybridSet& aSet)
+        {
+            std::vector<Word_t> keys, values;
+            Word_t i = 0;
+            try
+            {
+                for (PPvoid_t v = JudyLFirst(aSet.m_Array, &i, PJE0); NULL != v; v = JudyLNext(aSet.m_Array, &i, PJE0))
+                {
+                    std::unique_ptr<hybrid_chunk> c(new hybrid_chunk(*static_cast<const hybrid_chunk*>(*v)));
+                    keys.push_back(i);
+                    values.push_back(reinterpret_cast<Word_t>(c.get()));
+                    c.release();
+                }
+            }
+            catch (...)
+            {
+                dispose(values);
+                throw;
+            }
+            if (!keys.empty() && JERR == JudyLInsArray(&m_Array, keys.size(), keys.data(), values.data(), PJE0))
+            {
+                JudyLFreeArray(&m_Array, PJE0);
+                dispose(values);
+                throw std::bad_alloc();
+            }
+            m_Size = aSet.m_Size;
+        }
+
+        //! deletes chunks which are not in the array
+        static void dispose(const std::vector<Word_t>& values)
+        {
+            for (Word_t c : values)
+                delete reinterpret_cast<hybrid_chunk*>(c);
+        }
+    };
+}// judypp
+
+#endif
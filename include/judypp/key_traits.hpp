@@ -0,0 +1,55 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_KEY_TRAITS_HPP__
+#define __JUDYPP_KEY_TRAITS_HPP__
+
+#include <Judy.h>
+#include <type_traits>
+
+namespace judypp
+{
+    //! Maps keys to Judy indexes so that the order of indexes is the order of keys.
+    //! Unsigned integers and pointers are taken as is.
+    template <typename Key, typename Enable = void>
+    struct key_traits
+    {
+        static Word_t encode(Key k) { return (Word_t)k; }
+        static Key decode(Word_t i) { return (Key)i; }
+    };
+
+    //! Signed integers are sign-extended to the word and get the sign bit flipped,
+    //! so negative keys go before positive ones
+    template <typename Key>
+    struct key_traits<Key, typename std::enable_if<std::is_signed<Key>::value>::type>
+    {
+        static const Word_t SIGN_BIT = Word_t(1) << (sizeof(Word_t) * 8 - 1);
+
+        static Word_t encode(Key k) { return (Word_t)k ^ SIGN_BIT; }
+        static Key decode(Word_t i) { return (Key)(i ^ SIGN_BIT); }
+    };
+
+    //! true if the index is the encoding of a key, false if it is out of the range of Key
+    template <typename Key>
+    inline bool key_fits(Word_t i) { return key_traits<Key>::encode(key_traits<Key>::decode(i)) == i; }
+}// judypp
+
+#endif
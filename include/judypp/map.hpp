@@ -22,61 +22,419 @@
 #ifndef __JUDYPP_MAP_HPP__
 #define __JUDYPP_MAP_HPP__
 
-#include <boost/noncopyable.hpp>
 #include <boost/static_assert.hpp>
 #include <boost/type_traits/is_integral.hpp>
 #include <boost/type_traits/is_pointer.hpp>
 #include <Judy.h>
+#include <judypp/map_iter.hpp>
+#include <judypp/key_traits.hpp>
+#include <judypp/memory.hpp>
+#include <judypp/reclaimer.hpp>
+#include <judypp/serialize.hpp>
+#include <judypp/value_storage.hpp>
+#include <algorithm>
+#include <memory>
+#include <string.h>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace judypp
 {
-    //! Key must be POD, T must be POD
-    template <typename Key, typename T>
-    class Map : boost::noncopyable
+    template <typename Key, typename T> class FrozenMap;
+
+    //! Key must be POD, T is any movable type. Small trivially copyable T is kept in the slots
+    //! of JudyL, other ones in the pool of the map (see value_storage.hpp)
+    //! Alloc is heap_alloc, arena_alloc or checked<> of them (see memory.hpp)
+    template <typename Key, typename T, typename Alloc = default_alloc>
+    class Map
     {
         Pvoid_t m_Array;
+        size_t m_Size;
+        Alloc m_Alloc;
+
+        typedef typename Alloc::scope scope;
+        typedef key_traits<Key> traits;
+        typedef value_storage<T> storage;
+
+        typename storage::pool m_Values;
 
     public:
         BOOST_STATIC_ASSERT(sizeof(Key) <= sizeof(Word_t));
-        BOOST_STATIC_ASSERT(sizeof(T) <= sizeof(Word_t));
         BOOST_STATIC_ASSERT(boost::is_integral<Key>::value || boost::is_pointer<Key>::value);
-        BOOST_STATIC_ASSERT(boost::is_integral<T>::value || boost::is_pointer<T>::value);
 
         typedef Key key_type;
         typedef T mapped_type;
         typedef std::pair<const Key, T> value_type;
 
-        Map() : m_Array(NULL) {}
+        typedef map_iterator<Key, T> iterator;
+        typedef map_const_iterator<Key, T> const_iterator;
+
+        Map() : m_Array(NULL), m_Size(0) {}
+        Map(const Map& aMap) : Map() { copy(aMap); }
+        Map(Map&& aMap) noexcept : m_Array(aMap.m_Array), m_Size(aMap.m_Size), m_Alloc(std::move(aMap.m_Alloc)),
+            m_Values(std::move(aMap.m_Values))
+        {
+            aMap.m_Array = NULL;
+            aMap.m_Size = 0;
+        }
         ~Map() { clear(); }
+        Map& operator=(const Map& aMap)
+        {
+            if (&aMap != this)
+            {
+                clear();
+                copy(aMap);
+            }
+            return *this;
+        }
+        Map& operator=(Map&& aMap) noexcept
+        {
+            if (&aMap != this)
+            {
+                clear();
+                swap(aMap);
+            }
+            return *this;
+        }
+
+        void swap(Map& aMap) noexcept
+        {
+            std::swap(m_Array, aMap.m_Array);
+            std::swap(m_Size, aMap.m_Size);
+            std::swap(m_Alloc, aMap.m_Alloc);
+            std::swap(m_Values, aMap.m_Values);
+        }
 
         // own interface
         //! inserts value by key or searches for existing. \return reference to it
-        mapped_type& put(key_type key) { return *reinterpret_cast<mapped_type*>(JudyLIns(&m_Array, (Word_t)key, PJE0)); }
+        mapped_type& put(key_type key) { return storage::ref(reinterpret_cast<PWord_t>(emplace(traits::encode(key)).first)); }
 
         //! searches for the element by key. \return pointer to it or NULL
-        const mapped_type* get(key_type key) const { return reinterpret_cast<mapped_type*>(JudyLGet(m_Array, (Word_t)key, PJE0)); }
-        mapped_type* get(key_type key) { return const_cast<mapped_type*>(const_cast<const Map<Key,T>*>(this)->get(key)); }
+        const mapped_type* get(key_type key) const
+        {
+            PPvoid_t v = JudyLGet(m_Array, traits::encode(key), PJE0);
+            return NULL == v ? NULL : &storage::ref(reinterpret_cast<PWord_t>(v));
+        }
+        mapped_type* get(key_type key) { return const_cast<mapped_type*>(const_cast<const Map*>(this)->get(key)); }
+
+        /*
+         * Searches for n keys, out[i] is the pointer to the value of keys[i] or NULL.
+         * \return count of found keys
+         * Ascending keys are faster: the search for a key gives the next present one, so all
+         * keys up to it are resolved without descending the tree again.
+         */
+        size_t get_many(const key_type* keys, size_t n, const mapped_type** out) const
+        {
+            size_t found = 0;
+            // there are no keys in [lo, next), next is present unless end is true
+            Word_t lo = 1, next = 0;
+            PPvoid_t v = NULL;
+            bool end = false;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const Word_t k = traits::encode(keys[i]);
+                if (k < lo || (!end && k > next))
+                {
+                    lo = next = k;
+                    v = JudyLFirst(m_Array, &next, PJE0);
+                    end = NULL == v;
+                }
+                out[i] = !end && k == next ? &storage::ref(reinterpret_cast<PWord_t>(v)) : NULL;
+                found += NULL != out[i];
+            }
+            return found;
+        }
+        size_t get_many(const key_type* keys, size_t n, mapped_type** out)
+        {
+            return const_cast<const Map*>(this)->get_many(keys, n, const_cast<const mapped_type**>(out));
+        }
+
+        bool del(key_type key)
+        {
+            // the value out of the slot is freed after the key is removed
+            PPvoid_t v = storage::inplace ? NULL : JudyLGet(m_Array, traits::encode(key), PJE0);
+            const Word_t w = NULL == v ? 0 : *reinterpret_cast<PWord_t>(v);
+            bool r;
+            {
+                scope s(m_Alloc);
+                r = s.check(JudyLDel(&m_Array, traits::encode(key), s.error()));
+            }
+            m_Size -= r;
+            // out of the scope, so Judy memory of the value goes back to its own allocator
+            if (NULL != v)
+                storage::dispose(m_Values, w);
+            return r;
+        }
+
+        //! O(1), population is maintained by put/del/clear
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        //! bytes occupied by the Judy array and the pool of values
+        size_t memory_usage() const { return JudyLMemUsed(m_Array) + storage::bytes(m_Values); }
 
-        bool del(key_type key) { return JudyLDel(&m_Array, (Word_t)key, PJE0); }
+        //! counts keys in [lo, hi] by the tree
+        size_t count(key_type lo, key_type hi) const { return JudyLCount(m_Array, traits::encode(lo), traits::encode(hi), PJE0); }
 
-        size_t size() const { return JudyLCount(m_Array, 0, -1, PJE0); }
+        //! count of keys <= key
+        size_t rank(key_type key) const { return JudyLCount(m_Array, 0, traits::encode(key), PJE0); }
 
-        bool empty() const { return 0 == size(); }
+        //! calls f(key, value) for all elements in order without iterator objects, each step is
+        //! one JudyLNext which also gives the value. Keys must not be inserted or removed by f
+        template <typename F>
+        void for_each(F f) { walk<mapped_type>(m_Array, 0, Word_t(-1), f); }
+        template <typename F>
+        void for_each(F f) const { walk<const mapped_type>(m_Array, 0, Word_t(-1), f); }
 
-        void clear() { JudyLFreeArray(&m_Array, PJE0); }
+        //! calls f(key, value) for keys in [lo, hi] in order
+        template <typename F>
+        void for_each_range(key_type lo, key_type hi, F f) { walk<mapped_type>(m_Array, traits::encode(lo), traits::encode(hi), f); }
+        template <typename F>
+        void for_each_range(key_type lo, key_type hi, F f) const { walk<const mapped_type>(m_Array, traits::encode(lo), traits::encode(hi), f); }
+
+        /*
+         * Copies up to max keys >= lo in order to keys and their values to values.
+         * \return count of copied elements and true if there are more keys, then lo is set
+         * to the next one to resume from.
+         */
+        std::pair<size_t, bool> copy_entries(key_type& lo, key_type* keys, mapped_type* values, size_t max) const
+        {
+            Word_t i = traits::encode(lo);
+            size_t n = 0;
+            for (PPvoid_t v = JudyLFirst(m_Array, &i, PJE0); NULL != v; v = JudyLNext(m_Array, &i, PJE0))
+            {
+                if (n == max)
+                {
+                    lo = traits::decode(i);
+                    return std::make_pair(n, true);
+                }
+                keys[n] = traits::decode(i);
+                if (NULL != values)
+                    values[n] = storage::ref(reinterpret_cast<PWord_t>(v));
+                ++n;
+            }
+            return std::make_pair(n, false);
+        }
+
+        //! copy_entries() without values
+        std::pair<size_t, bool> copy_keys(key_type& lo, key_type* out, size_t max) const { return copy_entries(lo, out, NULL, max); }
+
+        void clear()
+        {
+            storage::dispose_all(m_Values, m_Array);
+            free_array();
+        }
+
+        /*
+         * Removes keys in [lo, hi]. \return count of removed keys
+         * Judy has no removal of subtrees, so if the most of keys are in the range, the rest
+         * ones are built bottom-up into the new array and the old one is freed at once.
+         * Otherwise keys are removed one by one.
+         */
+        size_t erase_range(key_type lo, key_type hi)
+        {
+            const Word_t l = traits::encode(lo), h = traits::encode(hi);
+            const size_t n = l > h ? 0 : JudyLCount(m_Array, l, h, PJE0);
+            if (0 == n)
+                return 0;
+
+            if (2 * n < m_Size)
+            {
+                Word_t i = l;
+                PPvoid_t v;
+                for (size_t k = 0; k < n && NULL != (v = JudyLFirst(m_Array, &i, PJE0)); ++k)
+                {
+                    const Word_t w = *reinterpret_cast<PWord_t>(v);
+                    {
+                        scope s(m_Alloc);
+                        s.check(JudyLDel(&m_Array, i, s.error()));
+                    }
+                    --m_Size;
+                    storage::dispose(m_Values, w);
+                }
+                return n;
+            }
+
+            // values of the rest keys are moved to the new array as they are
+            std::vector<Word_t> keys, values;
+            keys.reserve(m_Size - n);
+            values.reserve(m_Size - n);
+            Word_t i = 0;
+            PPvoid_t v;
+            for (v = JudyLFirst(m_Array, &i, PJE0); NULL != v; v = JudyLNext(m_Array, &i, PJE0))
+            {
+                if (i < l || i > h)
+                {
+                    keys.push_back(i);
+                    values.push_back(*reinterpret_cast<PWord_t>(v));
+                }
+                else if (!storage::inplace)
+                {
+                    storage::dispose(m_Values, *reinterpret_cast<PWord_t>(v));
+                }
+                else if (h != i)
+                {
+                    // nothing to free in the range
+                    i = h;
+                    if (NULL == (v = JudyLNext(m_Array, &i, PJE0)))
+                        break;
+                    keys.push_back(i);
+                    values.push_back(*reinterpret_cast<PWord_t>(v));
+                }
+            }
+            free_array();
+            build(keys, values);
+            return n;
+        }
+
+        //! hands the array and values over to Reclaimer and returns at once, so destructors
+        //! of values run in its thread. Arena is released in place.
+        void clear_deferred()
+        {
+            if (!std::is_base_of<heap_alloc, Alloc>::value || NULL == m_Array)
+                return clear();
+
+            std::shared_ptr<std::pair<Pvoid_t, typename storage::pool> > g(
+                    new std::pair<Pvoid_t, typename storage::pool>(m_Array, std::move(m_Values)));
+            m_Array = NULL;
+            m_Size = 0;
+            Reclaimer::instance().post([g]
+                    {
+                        storage::dispose_all(g->second, g->first);
+                        JudyLFreeArray(&g->first, PJE0);
+                    });
+        }
+
+        //! immutable copy for lookups, T must be kept in the slots. It is defined in frozen.hpp
+        FrozenMap<Key, T> freeze() const;
+
+        //! writes keys and values in the compact format (see serialize.hpp), T must be kept in the slots.
+        //! \return false if the stream failed
+        bool save(std::ostream& os) const
+        {
+            static_assert(storage::inplace, "values out of the slots can not be saved");
+            std::streambuf& sb = *os.rdbuf();
+            bool ok = write_bytes(sb, MAP_MAGIC, sizeof(MAP_MAGIC)) && write_varint(sb, m_Size);
+            Word_t i = 0, prev = 0;
+            for (PPvoid_t v = JudyLFirst(m_Array, &i, PJE0); ok && NULL != v; v = JudyLNext(m_Array, &i, PJE0))
+            {
+                ok = write_varint(sb, i - prev) && write_bytes(sb, reinterpret_cast<const char*>(v), sizeof(mapped_type));
+                prev = i;
+            }
+            // the stream buffer does not report short writes to the stream
+            if (!ok)
+                os.setstate(std::ios::badbit);
+            return os.flush().good();
+        }
+
+        //! replaces the content by data written by save(), it is built bottom-up.
+        //! \return false if the input is broken or has keys out of Key, the map is not changed then
+        bool load(std::istream& is)
+        {
+            static_assert(storage::inplace, "values out of the slots can not be loaded");
+            std::streambuf& sb = *is.rdbuf();
+            Word_t n = 0;
+            if (!read_magic(sb, MAP_MAGIC) || !read_varint(sb, n))
+                return false;
+
+            std::vector<Word_t> keys, values;
+            keys.reserve(std::min<Word_t>(n, 1 << 20));
+            values.reserve(keys.capacity());
+            Word_t k = 0, d = 0;
+            for (Word_t i = 0; i < n; ++i)
+            {
+                Word_t v = 0;
+                if (!read_varint(sb, d) || (0 != i && (0 == d || k + d < k)) || !key_fits<Key>(k + d) ||
+                        sizeof(mapped_type) != sb.sgetn(reinterpret_cast<char*>(&v), sizeof(mapped_type)))
+                    return false;
+                keys.push_back(k += d);
+                values.push_back(v);
+            }
+
+            clear();
+            build(keys, values);
+            return true;
+        }
 
         // std::map interface
-        //! return true if new the key is inserted, false if key is already in (value was not changed)
-        bool insert(const value_type& v)
+        //! second is true if the new key is inserted, false if key is already in (value was not changed)
+        std::pair<iterator, bool> insert(const value_type& v) { return try_emplace(v.first, v.second); }
+
+        //! sorted input into the empty map is built bottom-up by JudyLInsArray, otherwise key by key
+        template <typename InputIt>
+        void insert(InputIt first, InputIt last)
         {
-            mapped_type* m = get(v.first);
-            if (NULL == m)
+            if (!empty())
+            {
+                for (; first != last; ++first)
+                    insert(*first);
+                return;
+            }
+
+            std::vector<Word_t> keys, values;
+            try
             {
-                put(v.first) = v.second;
-                return true;
+                for (; first != last; ++first)
+                {
+                    keys.push_back(traits::encode(first->first));
+                    values.push_back(storage::make(m_Values, first->second));
+                }
             }
-            return false;
+            catch (...)
+            {
+                dispose(values);
+                throw;
+            }
+
+            // values of repeated keys are dropped like try_emplace does
+            if (!build(keys, values))
+                for (size_t i = 0; i < keys.size(); ++i)
+                {
+                    std::pair<PPvoid_t, bool> r;
+                    try
+                    {
+                        r = ins(keys[i]);
+                    }
+                    catch (...)
+                    {
+                        for (size_t j = i; j < values.size(); ++j)
+                            storage::dispose(m_Values, values[j]);
+                        throw;
+                    }
+                    if (r.second)
+                        *reinterpret_cast<PWord_t>(r.first) = values[i];
+                    else
+                        storage::dispose(m_Values, values[i]);
+                }
+        }
+
+        //! replaces the content by [first, last), it takes the bulk path if input is sorted
+        template <typename InputIt>
+        void assign_sorted(InputIt first, InputIt last)
+        {
+            clear();
+            insert(first, last);
+        }
+
+        //! value is constructed in place from args only if the key is new
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type& k, Args&&... args)
+        {
+            std::pair<PPvoid_t, bool> r = emplace(traits::encode(k), std::forward<Args>(args)...);
+            return std::make_pair(iterator(m_Array, traits::encode(k), r.first), r.second);
+        }
+
+        //! second is true if the new key is inserted, false if existing value was assigned
+        template <typename M>
+        std::pair<iterator, bool> insert_or_assign(const key_type& k, M&& obj)
+        {
+            std::pair<PPvoid_t, bool> r = emplace(traits::encode(k), std::forward<M>(obj));
+            // obj is not moved from if the key exists
+            if (!r.second)
+                storage::ref(reinterpret_cast<PWord_t>(r.first)) = std::forward<M>(obj);
+            return std::make_pair(iterator(m_Array, traits::encode(k), r.first), r.second);
         }
 
         //! gets or creates value by the key
@@ -84,6 +442,171 @@ namespace judypp
 
         //! return count of erased keys (0 or 1)
         size_t erase(const key_type& k) { return del(k); }
+        void erase(const_iterator p) { erase(p->first); }
+
+        iterator begin() { return first_from(0); }
+        const_iterator begin() const { return first_from(0); }
+        iterator end() { return iterator(m_Array); }
+        const_iterator end() const { return const_iterator(m_Array); }
+
+        iterator find(const key_type& k) { return iterator(m_Array, traits::encode(k), JudyLGet(m_Array, traits::encode(k), PJE0)); }
+        const_iterator find(const key_type& k) const { return const_iterator(m_Array, traits::encode(k), JudyLGet(m_Array, traits::encode(k), PJE0)); }
+
+        //! first element with key >= k
+        iterator lower_bound(const key_type& k) { return first_from(traits::encode(k)); }
+        const_iterator lower_bound(const key_type& k) const { return first_from(traits::encode(k)); }
+
+        //! first element with key > k
+        iterator upper_bound(const key_type& k) { return next_from(traits::encode(k)); }
+        const_iterator upper_bound(const key_type& k) const { return next_from(traits::encode(k)); }
+
+        std::pair<iterator, iterator> equal_range(const key_type& k) { return std::make_pair(lower_bound(k), upper_bound(k)); }
+        std::pair<const_iterator, const_iterator> equal_range(const key_type& k) const { return std::make_pair(lower_bound(k), upper_bound(k)); }
+
+        //! n-th smallest key (from 0), end() if n >= size()
+        iterator select(size_t n) { return nth(n); }
+        const_iterator select(size_t n) const { return nth(n); }
+
+    private:
+        //! V is mapped_type or const mapped_type
+        template <typename V, typename F>
+        static void walk(Pcvoid_t aArray, Word_t l, Word_t h, F& f)
+        {
+            Word_t i = l;
+            if (l > h)
+                return;
+            for (PPvoid_t v = JudyLFirst(aArray, &i, PJE0); NULL != v && i <= h; v = JudyLNext(aArray, &i, PJE0))
+                f(traits::decode(i), static_cast<V&>(storage::ref(reinterpret_cast<PWord_t>(v))));
+        }
+
+        //! ordered walk of the source and bottom-up build of the empty map
+        void copy(const Map& aMap)
+        {
+            std::vector<Word_t> keys, values;
+            keys.reserve(aMap.m_Size);
+            values.reserve(aMap.m_Size);
+            try
+            {
+                Word_t i = 0;
+                for (PPvoid_t v = JudyLFirst(aMap.m_Array, &i, PJE0); NULL != v; v = JudyLNext(aMap.m_Array, &i, PJE0))
+                {
+                    keys.push_back(i);
+                    values.push_back(storage::make(m_Values, storage::ref(reinterpret_cast<PWord_t>(v))));
+                }
+            }
+            catch (...)
+            {
+                dispose(values);
+                throw;
+            }
+            build(keys, values);
+        }
+
+        //! builds the empty map from strictly ascending keys. \return false if keys are not such
+        bool build(const std::vector<Word_t>& keys, const std::vector<Word_t>& values)
+        {
+            for (size_t i = 1; i < keys.size(); ++i)
+                if (keys[i - 1] >= keys[i])
+                    return false;
+            if (keys.empty())
+                return false;
+            int r;
+            try
+            {
+                scope s(m_Alloc);
+                r = JudyLInsArray(&m_Array, keys.size(), keys.data(), values.data(), s.error());
+                // the map is left empty
+                if (JERR == r)
+                    JudyLFreeArray(&m_Array, PJE0);
+                r = s.check(r);
+            }
+            catch (...)
+            {
+                // values are freed out of the scope like in del()
+                dispose(values);
+                throw;
+            }
+            if (JERR == r)
+                dispose(values);
+            if (1 != r)
+                return false;
+            m_Size = keys.size();
+            return true;
+        }
+
+        //! single JudyLIns. \return value slot and true if the key is new
+        std::pair<PPvoid_t, bool> ins(Word_t i)
+        {
+            scope s(m_Alloc);
+            PPvoid_t v = s.check(JudyLIns(&m_Array, i, s.error()));
+            // new slot is zeroed by Judy, zero in old one is resolved by the root population
+            bool inserted = NULL == *v && m_Size != JudyLCount(m_Array, 0, -1, PJE0);
+            m_Size += inserted;
+            return std::make_pair(v, inserted);
+        }
+
+        //! ins() with construction of the new value, the key is removed back if it throws
+        template <typename... Args>
+        std::pair<PPvoid_t, bool> emplace(Word_t i, Args&&... args)
+        {
+            std::pair<PPvoid_t, bool> r = ins(i);
+            if (r.second)
+            {
+                try
+                {
+                    *reinterpret_cast<PWord_t>(r.first) = storage::make(m_Values, std::forward<Args>(args)...);
+                }
+                catch (...)
+                {
+                    scope s(m_Alloc);
+                    JudyLDel(&m_Array, i, PJE0);
+                    --m_Size;
+                    throw;
+                }
+            }
+            return r;
+        }
+
+        //! frees the array but not values
+        void free_array()
+        {
+            if (m_Alloc.release())
+            {
+                m_Array = NULL;
+            }
+            else
+            {
+                scope s(m_Alloc);
+                JudyLFreeArray(&m_Array, PJE0);
+            }
+            m_Size = 0;
+        }
+
+        //! frees values which are not put into the array
+        void dispose(const std::vector<Word_t>& values)
+        {
+            for (Word_t w : values)
+                storage::dispose(m_Values, w);
+        }
+
+        iterator first_from(Word_t i) const
+        {
+            PPvoid_t v = JudyLFirst(m_Array, &i, PJE0);
+            return iterator(m_Array, i, v);
+        }
+
+        iterator next_from(Word_t i) const
+        {
+            PPvoid_t v = JudyLNext(m_Array, &i, PJE0);
+            return iterator(m_Array, i, v);
+        }
+
+        iterator nth(size_t n) const
+        {
+            Word_t i = 0;
+            PPvoid_t v = JudyLByCount(m_Array, n + 1, &i, PJE0);
+            return iterator(m_Array, i, v);
+        }
     };
 }// judypp
 
@@ -0,0 +1,155 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_MAP_ITER_HPP__
+#define __JUDYPP_MAP_ITER_HPP__
+
+#include <Judy.h>
+#include <iterator>
+#include <judypp/key_traits.hpp>
+#include <judypp/value_storage.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace judypp
+{
+    // Iterator over JudyL array. Holds index and pointer to the value slot,
+    // m_Value == NULL means end(). Any insertion or deletion invalidates it.
+    class map_iterator_base
+    {
+    protected:
+        Pcvoid_t m_Array;
+        Word_t m_Index;
+        PWord_t m_Value;
+
+    public:
+        // like from end()
+        map_iterator_base(Pcvoid_t aArray = NULL) : m_Array(aArray), m_Index(0), m_Value(NULL) {}
+
+        // on concrete element returned by JudyLFirst/JudyLGet/etc, NULL aValue gives end()
+        map_iterator_base(Pcvoid_t aArray, Word_t aIndex, PPvoid_t aValue)
+            : m_Array(aArray), m_Index(aIndex), m_Value(reinterpret_cast<PWord_t>(aValue)) {}
+
+        bool operator == (const map_iterator_base& r) const
+        {
+            if (NULL == m_Value || NULL == r.m_Value)
+                return m_Value == r.m_Value;
+            else
+                return m_Array == r.m_Array && m_Index == r.m_Index;
+        }
+
+        void operator++ ()
+        {
+            m_Value = reinterpret_cast<PWord_t>(JudyLNext(m_Array, &m_Index, PJE0));
+        }
+
+        // decrement of end() moves to the last element
+        void operator-- ()
+        {
+            if (NULL == m_Value)
+                m_Index = -1, m_Value = reinterpret_cast<PWord_t>(JudyLLast(m_Array, &m_Index, PJE0));
+            else
+                m_Value = reinterpret_cast<PWord_t>(JudyLPrev(m_Array, &m_Index, PJE0));
+        }
+    };
+
+    inline bool operator != (const map_iterator_base& l, const map_iterator_base& r)
+    {
+        return !(l == r);
+    }
+
+    //! makes operator-> work for iterators returning pair by value
+    template <typename Ref>
+    struct map_arrow_proxy
+    {
+        Ref m_Ref;
+        const Ref* operator-> () const { return &m_Ref; }
+    };
+
+    //! T is mapped_type for iterator and const mapped_type for const_iterator
+    template <typename Key, typename T>
+    class basic_map_iterator : public map_iterator_base
+    {
+        typedef basic_map_iterator _Mytype;
+        typedef map_iterator_base _Mybase;
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, std::pair<const Key, T&>, ptrdiff_t,
+                map_arrow_proxy<std::pair<const Key, T&> >, std::pair<const Key, T&> > __iter_t;
+        typedef typename __iter_t::value_type           value_type;
+        typedef typename __iter_t::difference_type      difference_type;
+        typedef typename __iter_t::pointer              pointer;
+        typedef typename __iter_t::reference            reference;
+        typedef typename __iter_t::iterator_category    iterator_category;
+
+        basic_map_iterator(Pcvoid_t aArray = NULL) : _Mybase(aArray) {}
+        basic_map_iterator(Pcvoid_t aArray, Word_t aIndex, PPvoid_t aValue) : _Mybase(aArray, aIndex, aValue) {}
+
+        // iterator -> const_iterator
+        template <typename U>
+        basic_map_iterator(const basic_map_iterator<Key, U>& r,
+                typename std::enable_if<std::is_convertible<U*, T*>::value>::type* = NULL) : _Mybase(r) {}
+
+        _Mytype& operator++ ()
+        {
+            _Mybase::operator++();
+            return *this;
+        }
+
+        _Mytype operator++ (int)
+        {
+            _Mytype tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        _Mytype& operator-- ()
+        {
+            _Mybase::operator--();
+            return *this;
+        }
+
+        _Mytype operator-- (int)
+        {
+            _Mytype tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        reference operator* () const
+        {
+            return reference(key_traits<Key>::decode(m_Index), value_storage<typename std::remove_const<T>::type>::ref(m_Value));
+        }
+
+        pointer operator-> () const
+        {
+            return pointer{**this};
+        }
+    };
+
+    template <typename Key, typename T>
+    using map_iterator = basic_map_iterator<Key, T>;
+
+    template <typename Key, typename T>
+    using map_const_iterator = basic_map_iterator<Key, const T>;
+}// judypp
+
+#endif
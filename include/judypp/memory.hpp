@@ -0,0 +1,337 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_MEMORY_HPP__
+#define __JUDYPP_MEMORY_HPP__
+
+#include <Judy.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Process-wide accounting of memory allocated by Judy and arena allocation of Judy nodes.
+ *
+ * Judy allocates all its nodes through JudyMalloc/JudyFree, which may be replaced by the
+ * application. Define JUDYPP_DEFINE_MALLOC_HOOKS before including this header in exactly
+ * one translation unit to replace them with counting ones, which also take nodes from the
+ * arena of the current thread if there is one, and fail when the memory limit is reached.
+ * Pools of Map values which do not fit into the slots (see value_storage.hpp) are counted
+ * and limited the same way. Without the hooks arenas and the limit are not used.
+ */
+
+namespace judypp
+{
+    inline std::atomic<size_t>& allocated_bytes_counter()
+    {
+        static std::atomic<size_t> counter(0);
+        return counter;
+    }
+
+    //! bytes allocated by all Judy arrays and pools of values in the process, always 0 without the hooks
+    inline size_t allocated_bytes() { return allocated_bytes_counter().load(std::memory_order_relaxed); }
+
+    inline std::atomic<size_t>& memory_limit_counter()
+    {
+        static std::atomic<size_t> limit(size_t(-1));
+        return limit;
+    }
+
+    //! JudyMalloc and pools of values fail when allocated_bytes() would exceed the limit, only with the hooks
+    inline void set_memory_limit(size_t aBytes) { memory_limit_counter().store(aBytes, std::memory_order_relaxed); }
+
+    inline size_t memory_limit() { return memory_limit_counter().load(std::memory_order_relaxed); }
+
+    //! true if aBytes more may be allocated under the limit
+    inline bool within_memory_limit(size_t aBytes) { return allocated_bytes() + aBytes <= memory_limit(); }
+
+    inline bool& malloc_hooks_flag()
+    {
+        static bool hooks = false;
+        return hooks;
+    }
+
+    //! true if JUDYPP_DEFINE_MALLOC_HOOKS is used in the program
+    inline bool malloc_hooks_enabled() { return malloc_hooks_flag(); }
+
+    //! Bump allocator of Judy nodes with free lists by size, all memory is returned by reset()
+    class Arena
+    {
+        PWord_t m_Chunks;       // list of chunks linked through their first word
+        PWord_t m_Pos;
+        PWord_t m_End;
+        size_t m_ChunkWords;
+        size_t m_Bytes;
+        std::vector<PWord_t> m_Free;
+
+        static const size_t FIRST_CHUNK_WORDS = 256;
+        static const size_t MAX_CHUNK_WORDS = 128 * 1024;
+
+    public:
+        Arena() : m_Chunks(NULL), m_Pos(NULL), m_End(NULL), m_ChunkWords(FIRST_CHUNK_WORDS), m_Bytes(0) {}
+        Arena(Arena&& r) noexcept : Arena() { swap(r); }
+        ~Arena() { reset(); }
+        Arena& operator=(Arena&& r) noexcept
+        {
+            if (&r != this)
+            {
+                reset();
+                swap(r);
+            }
+            return *this;
+        }
+
+        void swap(Arena& r) noexcept
+        {
+            std::swap(m_Chunks, r.m_Chunks);
+            std::swap(m_Pos, r.m_Pos);
+            std::swap(m_End, r.m_End);
+            std::swap(m_ChunkWords, r.m_ChunkWords);
+            std::swap(m_Bytes, r.m_Bytes);
+            m_Free.swap(r.m_Free);
+        }
+
+        //! \return NULL if out of memory like JudyMalloc does
+        PWord_t allocate(Word_t aWords)
+        {
+            if (aWords < m_Free.size() && NULL != m_Free[aWords])
+            {
+                PWord_t p = m_Free[aWords];
+                m_Free[aWords] = reinterpret_cast<PWord_t>(*p);
+                return p;
+            }
+
+            if (static_cast<size_t>(m_End - m_Pos) < aWords)
+            {
+                const size_t words = std::max(m_ChunkWords, aWords + 1);
+                if (!within_memory_limit(words * sizeof(Word_t)))
+                    return NULL;
+                PWord_t chunk = static_cast<PWord_t>(malloc(words * sizeof(Word_t)));
+                if (NULL == chunk)
+                    return NULL;
+                chunk[0] = reinterpret_cast<Word_t>(m_Chunks);
+                m_Chunks = chunk;
+                m_Pos = chunk + 1;
+                m_End = chunk + words;
+                m_ChunkWords = std::min(2 * m_ChunkWords, size_t(MAX_CHUNK_WORDS));
+                m_Bytes += words * sizeof(Word_t);
+                allocated_bytes_counter().fetch_add(words * sizeof(Word_t), std::memory_order_relaxed);
+            }
+
+            PWord_t p = m_Pos;
+            m_Pos += aWords;
+            return p;
+        }
+
+        //! the block is kept for reuse by the next allocation of the same size
+        void deallocate(void* aPtr, Word_t aWords)
+        {
+            if (m_Free.size() <= aWords)
+                m_Free.resize(aWords + 1, NULL);
+            PWord_t p = static_cast<PWord_t>(aPtr);
+            *p = reinterpret_cast<Word_t>(m_Free[aWords]);
+            m_Free[aWords] = p;
+        }
+
+        //! frees all chunks at once
+        void reset()
+        {
+            while (NULL != m_Chunks)
+            {
+                PWord_t next = reinterpret_cast<PWord_t>(m_Chunks[0]);
+                free(m_Chunks);
+                m_Chunks = next;
+            }
+            allocated_bytes_counter().fetch_sub(m_Bytes, std::memory_order_relaxed);
+            m_Pos = m_End = NULL;
+            m_ChunkWords = FIRST_CHUNK_WORDS;
+            m_Bytes = 0;
+            m_Free.clear();
+        }
+
+        //! bytes taken from the heap
+        size_t bytes() const { return m_Bytes; }
+    };
+
+    inline Arena*& current_arena()
+    {
+        static thread_local Arena* arena = NULL;
+        return arena;
+    }
+
+    //! Judy allocates from the arena in the current thread while the scope is alive
+    class ArenaScope
+    {
+        Arena* m_Prev;
+
+    public:
+        explicit ArenaScope(Arena* aArena) : m_Prev(current_arena()) { current_arena() = aArena; }
+        ~ArenaScope() { current_arena() = m_Prev; }
+
+        ArenaScope(const ArenaScope&) = delete;
+        ArenaScope& operator=(const ArenaScope&) = delete;
+    };
+
+    /*
+     * Allocation policies of containers. Every modification of the Judy array is done
+     * under the scope of the policy, release() returns true if the array is freed by it
+     * without walking the nodes.
+     *
+     * Judy calls that may allocate take the error argument from the scope and pass their
+     * result through its check(). Plain policies give PJE0 and return the result as is,
+     * so errors are ignored like before and checking costs nothing.
+     */
+    struct unchecked_scope
+    {
+        PJError_t error() { return PJE0; }
+
+        template <typename R>
+        R check(R r) { return r; }
+    };
+
+    //! nodes come from JudyMalloc
+    struct heap_alloc
+    {
+        struct scope : unchecked_scope { explicit scope(heap_alloc&) {} };
+
+        bool release() { return false; }
+    };
+
+    //! nodes come from the arena owned by the container, so the container is destroyed in O(1)
+    class arena_alloc
+    {
+        Arena m_Arena;
+
+    public:
+        struct scope : ArenaScope, unchecked_scope { explicit scope(arena_alloc& a) : ArenaScope(&a.m_Arena) {} };
+
+        bool release()
+        {
+            if (!malloc_hooks_enabled())
+                return false;
+            m_Arena.reset();
+            return true;
+        }
+
+        const Arena& arena() const { return m_Arena; }
+    };
+
+    //! Judy error other than out of memory
+    class judy_error : public std::runtime_error
+    {
+        int m_Errno;
+
+    public:
+        explicit judy_error(int aErrno) : std::runtime_error("Judy error " + std::to_string(aErrno)), m_Errno(aErrno) {}
+
+        //! JU_ERRNO() of the failed call
+        int code() const { return m_Errno; }
+    };
+
+    /*
+     * Alloc with error checking: Judy gets the real JError_t, out of memory throws
+     * std::bad_alloc and other errors throw judy_error. The size of the container is not
+     * changed by the failed call, so it may be used further when memory is freed.
+     */
+    template <typename Alloc>
+    struct checked : Alloc
+    {
+        class scope : public Alloc::scope
+        {
+            JError_t m_Error;
+
+        public:
+            explicit scope(checked& a) : Alloc::scope(a) {}
+
+            PJError_t error() { return &m_Error; }
+
+            int check(int r)
+            {
+                if (JERR == r)
+                    fail();
+                return r;
+            }
+
+            PPvoid_t check(PPvoid_t v)
+            {
+                if (PPJERR == v)
+                    fail();
+                return v;
+            }
+
+        private:
+            void fail() const
+            {
+                if (JU_ERRNO_NOMEM == JU_ERRNO(&m_Error))
+                    throw std::bad_alloc();
+                throw judy_error(JU_ERRNO(&m_Error));
+            }
+        };
+    };
+
+    //! policy of containers by default, define JUDYPP_CHECKED to check errors everywhere
+#ifdef JUDYPP_CHECKED
+    typedef checked<heap_alloc> default_alloc;
+#else
+    typedef heap_alloc default_alloc;
+#endif
+}// judypp
+
+#ifdef JUDYPP_DEFINE_MALLOC_HOOKS
+extern "C"
+{
+    static const bool judypp_malloc_hooks_registered = (judypp::malloc_hooks_flag() = true);
+
+    Word_t JudyMalloc(Word_t Words)
+    {
+        if (judypp::Arena* a = judypp::current_arena())
+            return (Word_t)a->allocate(Words);
+
+        if (!judypp::within_memory_limit(Words * sizeof(Word_t)))
+            return 0;
+        void* p = malloc(Words * sizeof(Word_t));
+        if (NULL != p)
+            judypp::allocated_bytes_counter().fetch_add(Words * sizeof(Word_t), std::memory_order_relaxed);
+        return (Word_t)p;
+    }
+
+    void JudyFree(void* PWord, Word_t Words)
+    {
+        if (judypp::Arena* a = judypp::current_arena())
+            return a->deallocate(PWord, Words);
+
+        free(PWord);
+        judypp::allocated_bytes_counter().fetch_sub(Words * sizeof(Word_t), std::memory_order_relaxed);
+    }
+
+    Word_t JudyMallocVirtual(Word_t Words) { return JudyMalloc(Words); }
+
+    void JudyFreeVirtual(void* PWord, Word_t Words) { JudyFree(PWord, Words); }
+}
+#endif
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_RECLAIMER_HPP__
+#define __JUDYPP_RECLAIMER_HPP__
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace judypp
+{
+    //! Background thread freeing arrays handed over by clear_deferred() of containers
+    class Reclaimer
+    {
+        std::mutex m_Lock;
+        std::condition_variable m_Ready;
+        std::condition_variable m_Idle;
+        std::deque<std::function<void()> > m_Tasks;
+        size_t m_Busy;
+        bool m_Stop;
+        std::thread m_Thread;
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(m_Lock);
+            for (;;)
+            {
+                m_Ready.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+                // the queue is drained before the stop
+                if (m_Tasks.empty())
+                    return;
+
+                std::function<void()> f = std::move(m_Tasks.front());
+                m_Tasks.pop_front();
+                ++m_Busy;
+                lock.unlock();
+                f();
+                lock.lock();
+                if (0 == --m_Busy && m_Tasks.empty())
+                    m_Idle.notify_all();
+            }
+        }
+
+    public:
+        Reclaimer() : m_Busy(0), m_Stop(false), m_Thread(&Reclaimer::run, this) {}
+        ~Reclaimer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Lock);
+                m_Stop = true;
+            }
+            m_Ready.notify_one();
+            m_Thread.join();
+        }
+
+        Reclaimer(const Reclaimer&) = delete;
+        Reclaimer& operator=(const Reclaimer&) = delete;
+
+        //! process-wide instance, it finishes all tasks at exit
+        static Reclaimer& instance()
+        {
+            static Reclaimer r;
+            return r;
+        }
+
+        void post(std::function<void()> f)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Lock);
+                m_Tasks.push_back(std::move(f));
+            }
+            m_Ready.notify_one();
+        }
+
+        //! waits till all posted tasks are done
+        void drain()
+        {
+            std::unique_lock<std::mutex> lock(m_Lock);
+            m_Idle.wait(lock, [this] { return 0 == m_Busy && m_Tasks.empty(); });
+        }
+    };
+
+    //! runs f(i) for i in [0, n) on up to aThreads threads including the calling one
+    template <typename F>
+    void parallel_for(size_t n, unsigned aThreads, F f)
+    {
+        std::vector<std::thread> threads;
+        const size_t t = std::max<size_t>(1, std::min<size_t>(aThreads, n));
+        for (size_t k = 1; k < t; ++k)
+            threads.emplace_back([&f, k, n, t] { for (size_t i = k; i < n; i += t) f(i); });
+        for (size_t i = 0; i < n; i += t)
+            f(i);
+        for (auto& th : threads)
+            th.join();
+    }
+}// judypp
+
+#endif
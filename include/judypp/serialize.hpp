@@ -0,0 +1,90 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_SERIALIZE_HPP__
+#define __JUDYPP_SERIALIZE_HPP__
+
+#include <Judy.h>
+#include <istream>
+#include <ostream>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Compact stream format of Set and Map:
+ *   8 bytes of magic, count of keys as varint,
+ *   for each key in the ascending order: the difference with the previous encoded key
+ *   (with 0 for the first one) as varint, then sizeof(T) raw bytes of the value for Map.
+ * Varint is LEB128: 7 bits per byte starting from the lowest ones, the high bit is set
+ * in all bytes except the last one. Values are written in the byte order of the host.
+ */
+
+namespace judypp
+{
+    static const char SET_MAGIC[8] = {'J', 'U', 'D', 'Y', 'P', 'P', 's', 1};
+    static const char MAP_MAGIC[8] = {'J', 'U', 'D', 'Y', 'P', 'P', 'm', 1};
+
+    //! \return false on a short write
+    inline bool write_bytes(std::streambuf& sb, const char* p, size_t n)
+    {
+        return std::streamsize(n) == sb.sputn(p, n);
+    }
+
+    //! \return false on a short write
+    inline bool write_varint(std::streambuf& sb, Word_t v)
+    {
+        char buf[(sizeof(Word_t) * 8 + 6) / 7];
+        size_t n = 0;
+        do
+        {
+            buf[n] = v & 0x7f;
+            v >>= 7;
+            buf[n++] |= v ? 0x80 : 0;
+        }
+        while (0 != v);
+        return write_bytes(sb, buf, n);
+    }
+
+    //! \return false on the end of the stream or too long number
+    inline bool read_varint(std::streambuf& sb, Word_t& v)
+    {
+        v = 0;
+        for (unsigned shift = 0; shift < sizeof(Word_t) * 8; shift += 7)
+        {
+            const int c = sb.sbumpc();
+            if (std::char_traits<char>::eof() == c)
+                return false;
+            v |= Word_t(c & 0x7f) << shift;
+            if (0 == (c & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    //! \return false if the stream does not start with the magic
+    inline bool read_magic(std::streambuf& sb, const char (&magic)[8])
+    {
+        char buf[sizeof(magic)];
+        return sizeof(buf) == sb.sgetn(buf, sizeof(buf)) && 0 == memcmp(buf, magic, sizeof(buf));
+    }
+}// judypp
+
+#endif
@@ -26,15 +26,43 @@
 #include <boost/type_traits/is_integral.hpp>
 #include <boost/type_traits/is_pointer.hpp>
 #include <Judy.h>
+#include <judypp/key_traits.hpp>
+#include <judypp/memory.hpp>
+#include <judypp/reclaimer.hpp>
+#include <judypp/serialize.hpp>
 #include <judypp/set_iter.hpp>
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace judypp
 {
+    template <typename Key, typename Alloc> class Set;
+    template <typename Key> class FrozenSet;
+
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_union(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b);
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_intersection(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b);
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_difference(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b);
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_symmetric_difference(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b);
+
     //! Key must be an integral type with sizeof(Key) <= sizeof(Word_t)
-    template <typename Key>
+    //! Alloc is heap_alloc, arena_alloc or checked<> of them (see memory.hpp)
+    template <typename Key, typename Alloc = default_alloc>
     class Set
     {
         Pvoid_t m_Array;
+        size_t m_Size;
+        Alloc m_Alloc;
+
+        typedef typename Alloc::scope scope;
+        typedef key_traits<Key> traits;
 
     public:
         BOOST_STATIC_ASSERT(sizeof(Key) <= sizeof(Word_t));
@@ -45,37 +73,335 @@ namespace judypp
 
         typedef set_const_iterator<Key> const_iterator;
 
-        Set() : m_Array(NULL) {}
-        Set(const Set& aSet) : Set() { for (auto x : aSet) set(x); }
+        Set() : m_Array(NULL), m_Size(0) {}
+        Set(const Set& aSet) : Set() { copy(aSet); }
+        Set(Set&& aSet) noexcept : m_Array(aSet.m_Array), m_Size(aSet.m_Size), m_Alloc(std::move(aSet.m_Alloc))
+        {
+            aSet.m_Array = NULL;
+            aSet.m_Size = 0;
+        }
         ~Set() { clear(); }
         Set& operator=(const Set& aSet)
         {
             if (&aSet != this)
             {
                 clear();
-                for (auto x : aSet) set(x);
+                copy(aSet);
             }
             return *this;
         }
+        Set& operator=(Set&& aSet) noexcept
+        {
+            if (&aSet != this)
+            {
+                clear();
+                swap(aSet);
+            }
+            return *this;
+        }
+
+        void swap(Set& aSet) noexcept
+        {
+            std::swap(m_Array, aSet.m_Array);
+            std::swap(m_Size, aSet.m_Size);
+            std::swap(m_Alloc, aSet.m_Alloc);
+        }
 
         //! returns true if new bit is set in result of call, otherwise returns false
-        bool set(key_type key) { return Judy1Set(&m_Array, (Word_t)key, PJE0); }
+        bool set(key_type key)
+        {
+            scope s(m_Alloc);
+            bool r = s.check(Judy1Set(&m_Array, traits::encode(key), s.error()));
+            m_Size += r;
+            return r;
+        }
 
         //! returns true if bit is unset in result of call, otherwise returns false
-        bool unset(key_type key) { return Judy1Unset(&m_Array, (Word_t)key, PJE0); }
+        bool unset(key_type key)
+        {
+            scope s(m_Alloc);
+            bool r = s.check(Judy1Unset(&m_Array, traits::encode(key), s.error()));
+            m_Size -= r;
+            return r;
+        }
+
+        bool test(key_type key) const { return Judy1Test(m_Array, traits::encode(key), PJE0); }
+
+        /*
+         * Tests n keys, out[i] is true if keys[i] is present. \return count of present keys
+         * Ascending keys are faster: the search for a key gives the next present one, so all
+         * keys up to it are resolved without descending the tree again.
+         */
+        size_t test_many(const key_type* keys, size_t n, bool* out) const
+        {
+            size_t found = 0;
+            // there are no keys in [lo, next), next is present unless end is true
+            Word_t lo = 1, next = 0;
+            bool end = false;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const Word_t k = traits::encode(keys[i]);
+                if (k < lo || (!end && k > next))
+                {
+                    lo = next = k;
+                    end = 0 == Judy1First(m_Array, &next, PJE0);
+                }
+                out[i] = !end && k == next;
+                found += out[i];
+            }
+            return found;
+        }
+
+        //! O(1), population is maintained by set/unset/clear
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        //! bytes occupied by the Judy array
+        size_t memory_usage() const { return Judy1MemUsed(m_Array); }
+
+        //! counts keys in [lo, hi] by the tree
+        size_t count(key_type lo, key_type hi) const { return Judy1Count(m_Array, traits::encode(lo), traits::encode(hi), PJE0); }
+
+        //! count of keys <= key
+        size_t rank(key_type key) const { return Judy1Count(m_Array, 0, traits::encode(key), PJE0); }
+
+        //! calls f(key) for all keys in order, faster than iterators. The set must not be changed by f
+        template <typename F>
+        void for_each(F f) const { walk(0, Word_t(-1), f); }
+
+        //! calls f(key) for keys in [lo, hi] in order
+        template <typename F>
+        void for_each_range(key_type lo, key_type hi, F f) const { walk(traits::encode(lo), traits::encode(hi), f); }
+
+        /*
+         * Copies up to max keys >= lo in order to out. \return count of copied keys and true if
+         * there are more keys, then lo is set to the next one to resume from.
+         */
+        std::pair<size_t, bool> copy_keys(key_type& lo, key_type* out, size_t max) const
+        {
+            Word_t i = traits::encode(lo);
+            size_t n = 0;
+            set_cursor c;
+            for (bool more = 0 != Judy1First(m_Array, &i, PJE0); more; more = c.next(m_Array, i))
+            {
+                if (n == max)
+                {
+                    lo = traits::decode(i);
+                    return std::make_pair(n, true);
+                }
+                out[n++] = traits::decode(i);
+            }
+            return std::make_pair(n, false);
+        }
 
-        bool test(key_type key) const { return Judy1Test(m_Array, (Word_t)key, PJE0); }
+        /*
+         * Writes keys in [lo, hi] as bits of (hi - lo) / 64 + 1 words to out, bit j of out[w]
+         * stands for the key lo + 64 * w + j. \return count of keys in the range
+         */
+        size_t to_bitmap(key_type lo, key_type hi, uint64_t* out) const
+        {
+            const Word_t l = traits::encode(lo), h = traits::encode(hi);
+            if (l > h)
+                return 0;
+            std::fill(out, out + (h - l) / 64 + 1, uint64_t(0));
+            size_t n = 0;
+            auto f = [&] (key_type k)
+                    {
+                        const Word_t b = traits::encode(k) - l;
+                        out[b / 64] |= uint64_t(1) << (b % 64);
+                        ++n;
+                    };
+            walk(l, h, f);
+            return n;
+        }
+
+        /*
+         * Sets the keys of bits in n words, bit j of words[w] stands for the key lo + 64 * w + j.
+         * Zero words are skipped, the empty set is built bottom-up. Bits past the largest key
+         * are ignored. \return count of new keys
+         */
+        size_t from_bitmap(key_type lo, const uint64_t* words, size_t n)
+        {
+            const Word_t l = traits::encode(lo);
+            if (empty())
+            {
+                std::vector<Word_t> keys;
+                bits(l, words, n, [&] (Word_t i) { keys.push_back(i); });
+                build_sorted(keys);
+                return m_Size;
+            }
+
+            size_t added = 0;
+            bits(l, words, n, [&] (Word_t i) { added += set(traits::decode(i)); });
+            return added;
+        }
 
-        size_t size() const { return Judy1Count(m_Array, 0, -1, PJE0); }
+        void clear()
+        {
+            if (m_Alloc.release())
+            {
+                m_Array = NULL;
+            }
+            else
+            {
+                scope s(m_Alloc);
+                Judy1FreeArray(&m_Array, PJE0);
+            }
+            m_Size = 0;
+        }
+
+        /*
+         * Removes keys in [lo, hi]. \return count of removed keys
+         * Judy has no removal of subtrees, so if the most of keys are in the range, the rest
+         * ones are built bottom-up into the new array and the old one is freed at once.
+         * Otherwise keys are removed one by one.
+         */
+        size_t erase_range(key_type lo, key_type hi)
+        {
+            const Word_t l = traits::encode(lo), h = traits::encode(hi);
+            const size_t n = l > h ? 0 : Judy1Count(m_Array, l, h, PJE0);
+            if (0 == n)
+                return 0;
+
+            if (2 * n < m_Size)
+            {
+                scope s(m_Alloc);
+                Word_t i = l;
+                for (size_t k = 0; k < n && 0 != Judy1First(m_Array, &i, PJE0); ++k)
+                    m_Size -= s.check(Judy1Unset(&m_Array, i, s.error()));
+                return n;
+            }
+
+            std::vector<Word_t> keys;
+            keys.reserve(m_Size - n);
+            Word_t i = 0;
+            for (int r = Judy1First(m_Array, &i, PJE0); 0 != r && i < l; r = Judy1Next(m_Array, &i, PJE0))
+                keys.push_back(i);
+            i = h;
+            for (int r = Judy1Next(m_Array, &i, PJE0); 0 != r; r = Judy1Next(m_Array, &i, PJE0))
+                keys.push_back(i);
+            clear();
+            build_sorted(keys);
+            return n;
+        }
+
+        //! hands the array over to Reclaimer and returns at once. Arena is released in place.
+        void clear_deferred()
+        {
+            if (!std::is_base_of<heap_alloc, Alloc>::value || NULL == m_Array)
+                return clear();
+
+            Pvoid_t a = m_Array;
+            m_Array = NULL;
+            m_Size = 0;
+            Reclaimer::instance().post([a] () mutable { Judy1FreeArray(&a, PJE0); });
+        }
+
+        /*
+         * Replaces the content by [first, last). Keys are encoded and checked for the order by
+         * aThreads threads, then the set is built bottom-up by one Judy1SetArray: Judy has no
+         * way to join arrays built apart. Unsorted input is inserted key by key.
+         * See ShardedSet::build_parallel for building on all threads.
+         */
+        template <typename RandomIt>
+        void build_parallel(RandomIt first, RandomIt last, unsigned aThreads)
+        {
+            clear();
+            const size_t n = last - first;
+            const size_t chunk = 1 << 16;
+            std::vector<Word_t> keys(n);
+            std::atomic<bool> sorted(true);
+            parallel_for((n + chunk - 1) / chunk, aThreads, [&] (size_t c)
+                    {
+                        const size_t from = c * chunk, to = std::min(n, from + chunk);
+                        for (size_t i = from; i < to; ++i)
+                            keys[i] = traits::encode(first[i]);
+                        const Word_t prev = 0 == from ? 0 : traits::encode(first[from - 1]);
+                        if ((0 != from && prev >= keys[from]) || !ascending(keys, from, to))
+                            sorted = false;
+                    });
+
+            if (!sorted || !build_sorted(keys))
+                for (Word_t k : keys)
+                    set(traits::decode(k));
+        }
+
+        //! writes keys in the compact format (see serialize.hpp). \return false if the stream failed
+        bool save(std::ostream& os) const
+        {
+            std::streambuf& sb = *os.rdbuf();
+            bool ok = write_bytes(sb, SET_MAGIC, sizeof(SET_MAGIC)) && write_varint(sb, m_Size);
+            Word_t i = 0, prev = 0;
+            for (int r = Judy1First(m_Array, &i, PJE0); ok && 0 != r; r = Judy1Next(m_Array, &i, PJE0))
+            {
+                ok = write_varint(sb, i - prev);
+                prev = i;
+            }
+            // the stream buffer does not report short writes to the stream
+            if (!ok)
+                os.setstate(std::ios::badbit);
+            return os.flush().good();
+        }
+
+        //! immutable copy for lookups, it is defined in frozen.hpp
+        FrozenSet<Key> freeze() const;
+
+        //! replaces the content by keys written by save(), it is built bottom-up.
+        //! \return false if the input is broken or has keys out of Key, the set is not changed then
+        bool load(std::istream& is)
+        {
+            std::streambuf& sb = *is.rdbuf();
+            Word_t n = 0;
+            if (!read_magic(sb, SET_MAGIC) || !read_varint(sb, n))
+                return false;
 
-        bool empty() const { return 0 == size(); }
+            std::vector<Word_t> keys;
+            keys.reserve(std::min<Word_t>(n, 1 << 20));
+            Word_t k = 0, d = 0;
+            for (Word_t i = 0; i < n; ++i)
+            {
+                if (!read_varint(sb, d) || (0 != i && (0 == d || k + d < k)) || !key_fits<Key>(k + d))
+                    return false;
+                keys.push_back(k += d);
+            }
 
-        void clear() { Judy1FreeArray(&m_Array, PJE0); }
+            clear();
+            build_sorted(keys);
+            return true;
+        }
 
         // --- std::set interface ---
 
         bool insert(const value_type& v) { return set(v); }
 
+        //! sorted input into the empty set is built bottom-up by Judy1SetArray, otherwise key by key
+        template <typename InputIt>
+        void insert(InputIt first, InputIt last)
+        {
+            if (!empty())
+            {
+                for (; first != last; ++first)
+                    set(*first);
+                return;
+            }
+
+            std::vector<Word_t> keys;
+            for (; first != last; ++first)
+                keys.push_back(traits::encode(*first));
+            if (!build(keys))
+                for (Word_t k : keys)
+                    set(traits::decode(k));
+        }
+
+        //! replaces the content by [first, last), it takes the bulk path if input is sorted
+        template <typename InputIt>
+        void assign_sorted(InputIt first, InputIt last)
+        {
+            clear();
+            insert(first, last);
+        }
+
         //! return count of erased keys (0 or 1)
         size_t erase(const key_type& k) { return unset(k); }
         void erase(const_iterator p) { erase(*p); }
@@ -84,7 +410,238 @@ namespace judypp
         const_iterator end()   const { return const_iterator(); }
 
         const_iterator find(const key_type& k)  const { return const_iterator(m_Array, k); }
+
+        //! n-th smallest key (from 0), end() if n >= size()
+        const_iterator select(size_t n) const
+        {
+            Word_t i = 0;
+            return Judy1ByCount(m_Array, n + 1, &i, PJE0) ? const_iterator(m_Array, traits::decode(i)) : end();
+        }
+
+        // --- set algebra ---
+
+        //! O(size of r) inserts
+        Set& operator|= (const Set& r)
+        {
+            if (empty())
+                return *this = r;
+            Word_t i = 0;
+            for (int rc = Judy1First(r.m_Array, &i, PJE0); rc; rc = Judy1Next(r.m_Array, &i, PJE0))
+                set(traits::decode(i));
+            return *this;
+        }
+
+        //! result is rebuilt, the walk scales with the smaller set
+        Set& operator&= (const Set& r)
+        {
+            std::vector<Word_t> keys;
+            intersect(m_Array, r.m_Array, keys);
+            if (keys.size() != m_Size)
+            {
+                clear();
+                build(keys);
+            }
+            return *this;
+        }
+
+        //! common keys are unset, the walk scales with the smaller set
+        Set& operator-= (const Set& r)
+        {
+            std::vector<Word_t> keys;
+            intersect(m_Array, r.m_Array, keys);
+            for (Word_t k : keys)
+                unset(traits::decode(k));
+            return *this;
+        }
+
+        Set& operator^= (const Set& r) { return *this = set_symmetric_difference(*this, r); }
+
+        template <typename K, typename A> friend Set<K, A> set_union(const Set<K, A>&, const Set<K, A>&);
+        template <typename K, typename A> friend Set<K, A> set_intersection(const Set<K, A>&, const Set<K, A>&);
+        template <typename K, typename A> friend Set<K, A> set_difference(const Set<K, A>&, const Set<K, A>&);
+        template <typename K, typename A> friend Set<K, A> set_symmetric_difference(const Set<K, A>&, const Set<K, A>&);
+
+    private:
+        //! calls f(index) for set bits in order up to the largest key
+        template <typename F>
+        static void bits(Word_t l, const uint64_t* words, size_t n, F f)
+        {
+            for (size_t w = 0; w < n; ++w)
+                for (uint64_t x = words[w]; 0 != x; x &= x - 1)
+                {
+                    const Word_t i = l + 64 * w + __builtin_ctzll(x);
+                    if (i < l || !key_fits<Key>(i))
+                        return;
+                    f(i);
+                }
+        }
+
+        //! the runs of consecutive keys are passed by set_cursor without search
+        template <typename F>
+        void walk(Word_t l, Word_t h, F& f) const
+        {
+            Word_t i = l;
+            if (l > h || 0 == Judy1First(m_Array, &i, PJE0) || i > h)
+                return;
+            set_cursor c;
+            do
+            {
+                f(traits::decode(i));
+            }
+            while (c.next(m_Array, i) && i <= h);
+        }
+
+        //! sorted keys of a present in b. Seeks alternate between the arrays, each one skips
+        //! the run of keys absent in the other, so their count is bounded by the smaller array
+        static void intersect(Pcvoid_t a, Pcvoid_t b, std::vector<Word_t>& out)
+        {
+            Word_t x = 0;
+            if (0 == Judy1First(a, &x, PJE0))
+                return;
+            for (;;)
+            {
+                Word_t y = x;
+                if (0 == Judy1First(b, &y, PJE0))
+                    return;
+                if (y == x)
+                {
+                    out.push_back(x);
+                    if (0 == Judy1Next(a, &x, PJE0))
+                        return;
+                }
+                else
+                {
+                    x = y;
+                    if (0 == Judy1First(a, &x, PJE0))
+                        return;
+                }
+            }
+        }
+
+        //! sorted keys of a absent in b, b is searched only when a passes its current key
+        static void subtract(Pcvoid_t a, Pcvoid_t b, std::vector<Word_t>& out)
+        {
+            Word_t x = 0, y = 0;
+            bool more = Judy1First(b, &y, PJE0);
+            for (int rc = Judy1First(a, &x, PJE0); rc; rc = Judy1Next(a, &x, PJE0))
+            {
+                if (more && y < x)
+                {
+                    y = x;
+                    more = Judy1First(b, &y, PJE0);
+                }
+                if (!more || y != x)
+                    out.push_back(x);
+            }
+        }
+
+        //! sorted merge of both arrays, common keys are taken if both is true
+        static void merge(Pcvoid_t a, Pcvoid_t b, bool both, std::vector<Word_t>& out)
+        {
+            Word_t x = 0, y = 0;
+            bool more_a = Judy1First(a, &x, PJE0);
+            bool more_b = Judy1First(b, &y, PJE0);
+            while (more_a || more_b)
+            {
+                if (more_a && (!more_b || x < y))
+                {
+                    out.push_back(x);
+                    more_a = Judy1Next(a, &x, PJE0);
+                }
+                else if (more_b && (!more_a || y < x))
+                {
+                    out.push_back(y);
+                    more_b = Judy1Next(b, &y, PJE0);
+                }
+                else
+                {
+                    if (both)
+                        out.push_back(x);
+                    more_a = Judy1Next(a, &x, PJE0);
+                    more_b = Judy1Next(b, &y, PJE0);
+                }
+            }
+        }
+
+        //! ordered walk of the source and bottom-up build of the empty set
+        void copy(const Set& aSet)
+        {
+            std::vector<Word_t> keys;
+            keys.reserve(aSet.m_Size);
+            Word_t i = 0;
+            for (int rc = Judy1First(aSet.m_Array, &i, PJE0); rc; rc = Judy1Next(aSet.m_Array, &i, PJE0))
+                keys.push_back(i);
+            build(keys);
+        }
+
+        //! builds the empty set from strictly ascending keys. \return false if keys are not such
+        bool build(const std::vector<Word_t>& keys) { return ascending(keys, 0, keys.size()) && build_sorted(keys); }
+
+        static bool ascending(const std::vector<Word_t>& keys, size_t from, size_t to)
+        {
+            for (size_t i = from + 1; i < to; ++i)
+                if (keys[i - 1] >= keys[i])
+                    return false;
+            return true;
+        }
+
+        bool build_sorted(const std::vector<Word_t>& keys)
+        {
+            scope s(m_Alloc);
+            if (keys.empty())
+                return false;
+            const int r = Judy1SetArray(&m_Array, keys.size(), keys.data(), s.error());
+            if (JERR == r)
+                Judy1FreeArray(&m_Array, PJE0);     // the set is left empty
+            if (1 != s.check(r))
+                return false;
+            m_Size = keys.size();
+            return true;
+        }
     };
+
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_union(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b)
+    {
+        std::vector<Word_t> keys;
+        keys.reserve(a.size() + b.size());
+        Set<Key, Alloc>::merge(a.m_Array, b.m_Array, true, keys);
+        Set<Key, Alloc> r;
+        r.build(keys);
+        return r;
+    }
+
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_intersection(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b)
+    {
+        std::vector<Word_t> keys;
+        Set<Key, Alloc>::intersect(a.m_Array, b.m_Array, keys);
+        Set<Key, Alloc> r;
+        r.build(keys);
+        return r;
+    }
+
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_difference(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b)
+    {
+        std::vector<Word_t> keys;
+        keys.reserve(a.size());
+        Set<Key, Alloc>::subtract(a.m_Array, b.m_Array, keys);
+        Set<Key, Alloc> r;
+        r.build(keys);
+        return r;
+    }
+
+    template <typename Key, typename Alloc>
+    Set<Key, Alloc> set_symmetric_difference(const Set<Key, Alloc>& a, const Set<Key, Alloc>& b)
+    {
+        std::vector<Word_t> keys;
+        keys.reserve(a.size() + b.size());
+        Set<Key, Alloc>::merge(a.m_Array, b.m_Array, false, keys);
+        Set<Key, Alloc> r;
+        r.build(keys);
+        return r;
+    }
 }// judypp
 
 #endif
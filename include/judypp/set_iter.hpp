@@ -24,9 +24,59 @@
 
 #include <Judy.h>
 #include <iterator>
+#include <judypp/key_traits.hpp>
 
 namespace judypp
 {
+    /*
+     * Forward walk over Judy1 array which does not search for indexes inside runs of
+     * consecutive ones. After RUN_PROBE adjacent steps the end of the run is found by one
+     * Judy1NextEmpty and the rest of the run is passed by increments. Sparse arrays cost
+     * one Judy1Next per index as before. The array must not be changed during the walk.
+     *
+     * The Judy API gives no access to leaves, so the cursor can not resume inside one, and
+     * set_const_iterator does not use the cursor at all: iterators stay valid when other
+     * keys are erased and must skip the ones erased ahead of them, like std::set ones.
+     * Knowing of such erasures would take a counter shared by the set and its iterators,
+     * which swap() breaks. So each ++ is a Judy1Next, scans use Set::for_each.
+     */
+    class set_cursor
+    {
+        Word_t m_Left;          // count of indexes known to be present after the current one
+        unsigned m_Adjacent;
+
+        static const unsigned RUN_PROBE = 2;
+
+    public:
+        set_cursor() : m_Left(0), m_Adjacent(0) {}
+
+        //! moves aIndex to the next present index. \return false if there is no one
+        bool next(Pcvoid_t aArray, Word_t& aIndex)
+        {
+            if (0 != m_Left)
+            {
+                --m_Left;
+                ++aIndex;
+                return true;
+            }
+
+            const Word_t prev = aIndex;
+            if (0 == Judy1Next(aArray, &aIndex, PJE0))
+                return false;
+            if (aIndex != prev + 1)
+            {
+                m_Adjacent = 0;
+            }
+            else if (RUN_PROBE == ++m_Adjacent)
+            {
+                m_Adjacent = 0;
+                Word_t e = aIndex;
+                m_Left = 0 != Judy1NextEmpty(aArray, &e, PJE0) ? e - aIndex - 1 : Word_t(-1) - aIndex;
+            }
+            return true;
+        }
+    };
+
     class set_const_iterator_base
     {
     protected:
@@ -108,7 +158,7 @@ namespace judypp
         typedef typename __iter_t::iterator_category    iterator_category;
 
         set_const_iterator(Pcvoid_t aArray = NULL) : _Mybase(aArray) {}
-        set_const_iterator(Pcvoid_t aArray, Key aKey) : _Mybase(aArray, (Word_t)aKey) {}
+        set_const_iterator(Pcvoid_t aArray, Key aKey) : _Mybase(aArray, key_traits<Key>::encode(aKey)) {}
 
         _Mytype& operator++ ()
         {
@@ -138,7 +188,7 @@ namespace judypp
 
         reference operator* () const
         {
-            return (reference)m_Index;
+            return key_traits<Key>::decode(m_Index);
         }
     };
 }// judypp
@@ -0,0 +1,343 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_SHARDED_HPP__
+#define __JUDYPP_SHARDED_HPP__
+
+#include <boost/static_assert.hpp>
+#include <judypp/key_traits.hpp>
+#include <judypp/map.hpp>
+#include <judypp/reclaimer.hpp>
+#include <judypp/set.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace judypp
+{
+    constexpr unsigned shard_bits(size_t n) { return n <= 1 ? 0 : 1 + shard_bits(n / 2); }
+
+    //! default Shift of Sharded: the highest bits of the key, one shard takes no bits
+    template <typename Key>
+    constexpr unsigned shard_shift(size_t n) { return n <= 1 ? 0 : sizeof(Key) * 8 - shard_bits(n); }
+
+    /*
+     * N independent containers Cont, each one behind its own lock on its own cache line.
+     * The shard of a key is taken by log2(N) bits of the key starting at Shift. By default
+     * they are the highest bits of the key, so shards hold disjoint ranges and ordered
+     * iteration goes shard by shard. Dense small keys are better spread by a lower Shift,
+     * then ordered iteration merges the shards.
+     */
+    template <typename Cont, size_t N, unsigned Shift>
+    class Sharded
+    {
+    public:
+        typedef typename Cont::key_type key_type;
+
+    protected:
+        BOOST_STATIC_ASSERT(0 != N && 0 == (N & (N - 1)));
+        BOOST_STATIC_ASSERT(Shift + shard_bits(N) <= sizeof(Word_t) * 8 && Shift < sizeof(Word_t) * 8);
+
+        typedef key_traits<key_type> traits;
+
+        static constexpr unsigned TOP = Shift + shard_bits(N);
+
+        //! shards hold ascending ranges of keys if they are taken by the highest bits
+        static constexpr bool ordered() { return 1 == N || sizeof(Word_t) * 8 == TOP || sizeof(key_type) * 8 == TOP; }
+
+        //! the highest bit of a signed key narrower than a word is its sign, it is flipped
+        //! like key_traits does for the word, so negative keys go to the lower shards
+        static constexpr size_t SIGN_FLIP = std::is_signed<key_type>::value && sizeof(key_type) < sizeof(Word_t)
+            && sizeof(key_type) * 8 == TOP ? N / 2 : 0;
+
+        struct alignas(64) shard
+        {
+            mutable std::mutex lock;
+            Cont cont;
+        };
+
+        shard m_Shards[N];
+
+        static size_t shard_of(key_type k) { return ((traits::encode(k) >> Shift) & (N - 1)) ^ SIGN_FLIP; }
+
+        //! calls f(cont, indexes, count) under the lock of each shard having keys, once per shard
+        template <typename F>
+        void by_shard(const key_type* keys, size_t n, F f) const
+        {
+            size_t start[N + 1] = {0};
+            for (size_t i = 0; i < n; ++i)
+                ++start[shard_of(keys[i]) + 1];
+            for (size_t s = 0; s < N; ++s)
+                start[s + 1] += start[s];
+
+            std::vector<size_t> order(n);
+            size_t pos[N];
+            std::copy(start, start + N, pos);
+            for (size_t i = 0; i < n; ++i)
+                order[pos[shard_of(keys[i])]++] = i;
+
+            for (size_t s = 0; s < N; ++s)
+                if (start[s] != start[s + 1])
+                {
+                    std::lock_guard<std::mutex> lock(m_Shards[s].lock);
+                    f(const_cast<Cont&>(m_Shards[s].cont), order.data() + start[s], start[s + 1] - start[s]);
+                }
+        }
+
+        template <typename K>
+        static Word_t word_of(const K& k) { return key_traits<K>::encode(k); }
+        template <typename K, typename V>
+        static Word_t word_of(const std::pair<const K, V>& p) { return key_traits<K>::encode(p.first); }
+
+    public:
+        //! calls f(cont) for the shard of the key under its lock
+        template <typename F>
+        auto apply(key_type k, F f) -> decltype(f(std::declval<Cont&>()))
+        {
+            shard& s = m_Shards[shard_of(k)];
+            std::lock_guard<std::mutex> lock(s.lock);
+            return f(s.cont);
+        }
+        template <typename F>
+        auto apply(key_type k, F f) const -> decltype(f(std::declval<const Cont&>()))
+        {
+            const shard& s = m_Shards[shard_of(k)];
+            std::lock_guard<std::mutex> lock(s.lock);
+            return f(s.cont);
+        }
+
+        //! sum of sizes of the shards, each one is taken under its lock in turn
+        size_t size() const
+        {
+            size_t n = 0;
+            for (const shard& s : m_Shards)
+            {
+                std::lock_guard<std::mutex> lock(s.lock);
+                n += s.cont.size();
+            }
+            return n;
+        }
+
+        bool empty() const { return 0 == size(); }
+
+        void clear()
+        {
+            for (shard& s : m_Shards)
+            {
+                std::lock_guard<std::mutex> lock(s.lock);
+                s.cont.clear();
+            }
+        }
+
+        //! clears shards on aThreads threads
+        void clear_parallel(unsigned aThreads)
+        {
+            parallel_for(N, aThreads, [this] (size_t s)
+                    {
+                        std::lock_guard<std::mutex> lock(m_Shards[s].lock);
+                        m_Shards[s].cont.clear();
+                    });
+        }
+
+        //! hands arrays of all shards over to Reclaimer, see clear_deferred() of Set and Map
+        void clear_deferred()
+        {
+            for (shard& s : m_Shards)
+            {
+                std::lock_guard<std::mutex> lock(s.lock);
+                s.cont.clear_deferred();
+            }
+        }
+
+        //! ordered walk, all shards are locked while it goes
+        template <typename F>
+        void for_each(F f) const
+        {
+            std::unique_lock<std::mutex> locks[N];
+            for (size_t s = 0; s < N; ++s)
+                locks[s] = std::unique_lock<std::mutex>(m_Shards[s].lock);
+
+            if (ordered())
+            {
+                for (const shard& s : m_Shards)
+                    for (auto&& x : s.cont)
+                        f(x);
+                return;
+            }
+
+            typename Cont::const_iterator it[N], end[N];
+            for (size_t s = 0; s < N; ++s)
+            {
+                it[s] = m_Shards[s].cont.begin();
+                end[s] = m_Shards[s].cont.end();
+            }
+            for (;;)
+            {
+                size_t min = N;
+                for (size_t s = 0; s < N; ++s)
+                    if (it[s] != end[s] && (N == min || word_of(*it[s]) < word_of(*it[min])))
+                        min = s;
+                if (N == min)
+                    return;
+                f(*it[min]);
+                ++it[min];
+            }
+        }
+    };
+
+    //! Set for many writers, see Sharded
+    template <typename Key, size_t N, unsigned Shift = shard_shift<Key>(N)>
+    class ShardedSet : public Sharded<Set<Key>, N, Shift>
+    {
+    public:
+        //! returns true if new bit is set in result of call, otherwise returns false
+        bool set(Key key) { return this->apply(key, [key] (Set<Key>& s) { return s.set(key); }); }
+
+        //! returns true if bit is unset in result of call, otherwise returns false
+        bool unset(Key key) { return this->apply(key, [key] (Set<Key>& s) { return s.unset(key); }); }
+
+        bool test(Key key) const { return this->apply(key, [key] (const Set<Key>& s) { return s.test(key); }); }
+
+        //! sets n keys taking the lock of each shard once. \return count of new keys
+        size_t set_many(const Key* keys, size_t n)
+        {
+            size_t r = 0;
+            this->by_shard(keys, n, [&] (Set<Key>& s, const size_t* idx, size_t m)
+                    {
+                        for (size_t i = 0; i < m; ++i)
+                            r += s.set(keys[idx[i]]);
+                    });
+            return r;
+        }
+
+        /*
+         * Replaces the content by [first, last), each shard is built bottom-up on its own
+         * thread. Sorted input is split into ranges of shards by binary search when shards
+         * are taken by the highest bits, otherwise keys are distributed into buckets first.
+         */
+        template <typename RandomIt>
+        void build_parallel(RandomIt first, RandomIt last, unsigned aThreads)
+        {
+            typedef Sharded<Set<Key>, N, Shift> base;
+            RandomIt bounds[N + 1];
+            bounds[0] = first;
+            bounds[N] = last;
+            for (size_t s = 1; s < N; ++s)
+                bounds[s] = std::partition_point(bounds[s - 1], last, [s] (Key k) { return base::shard_of(k) < s; });
+
+            // the split is wrong if the input is not sorted
+            std::atomic<bool> split(base::ordered());
+            parallel_for(N, aThreads, [&] (size_t s)
+                    {
+                        std::lock_guard<std::mutex> lock(this->m_Shards[s].lock);
+                        this->m_Shards[s].cont.clear();
+                        if (split && std::all_of(bounds[s], bounds[s + 1], [s] (Key k) { return base::shard_of(k) == s; }))
+                            this->m_Shards[s].cont.assign_sorted(bounds[s], bounds[s + 1]);
+                        else
+                            split = false;
+                    });
+            if (split)
+                return;
+
+            std::vector<std::vector<Key> > buckets(N);
+            for (RandomIt it = first; it != last; ++it)
+                buckets[base::shard_of(*it)].push_back(*it);
+            parallel_for(N, aThreads, [&] (size_t s)
+                    {
+                        std::lock_guard<std::mutex> lock(this->m_Shards[s].lock);
+                        this->m_Shards[s].cont.assign_sorted(buckets[s].begin(), buckets[s].end());
+                        std::vector<Key>().swap(buckets[s]);
+                    });
+        }
+
+        //! tests n keys into out taking the lock of each shard once. \return count of present keys
+        size_t test_many(const Key* keys, size_t n, bool* out) const
+        {
+            size_t r = 0;
+            this->by_shard(keys, n, [&] (const Set<Key>& s, const size_t* idx, size_t m)
+                    {
+                        for (size_t i = 0; i < m; ++i)
+                            r += out[idx[i]] = s.test(keys[idx[i]]);
+                    });
+            return r;
+        }
+    };
+
+    //! Map for many writers, values are copied in and out under the lock, see Sharded
+    template <typename Key, typename T, size_t N, unsigned Shift = shard_shift<Key>(N)>
+    class ShardedMap : public Sharded<Map<Key, T>, N, Shift>
+    {
+    public:
+        //! assigns the value. \return true if the key is new
+        bool put(Key key, const T& value)
+        {
+            return this->apply(key, [&] (Map<Key, T>& m) { return m.insert_or_assign(key, value).second; });
+        }
+
+        //! copies the value into out. \return false if there is no key
+        bool get(Key key, T& out) const
+        {
+            return this->apply(key, [&] (const Map<Key, T>& m)
+                    {
+                        const T* v = m.get(key);
+                        if (NULL != v)
+                            out = *v;
+                        return NULL != v;
+                    });
+        }
+
+        bool del(Key key) { return this->apply(key, [key] (Map<Key, T>& m) { return m.del(key); }); }
+
+        //! assigns n values taking the lock of each shard once. \return count of new keys
+        size_t put_many(const Key* keys, const T* values, size_t n)
+        {
+            size_t r = 0;
+            this->by_shard(keys, n, [&] (Map<Key, T>& m, const size_t* idx, size_t k)
+                    {
+                        for (size_t i = 0; i < k; ++i)
+                            r += m.insert_or_assign(keys[idx[i]], values[idx[i]]).second;
+                    });
+            return r;
+        }
+
+        //! copies values of n keys into out, found[i] is false for absent ones. \return count of found keys
+        size_t get_many(const Key* keys, size_t n, T* out, bool* found) const
+        {
+            size_t r = 0;
+            this->by_shard(keys, n, [&] (const Map<Key, T>& m, const size_t* idx, size_t k)
+                    {
+                        for (size_t i = 0; i < k; ++i)
+                        {
+                            const T* v = m.get(keys[idx[i]]);
+                            if ((found[idx[i]] = NULL != v))
+                                out[idx[i]] = *v;
+                            r += NULL != v;
+                        }
+                    });
+            return r;
+        }
+    };
+}// judypp
+
+#endif
@@ -0,0 +1,553 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_STRING_MAP_HPP__
+#define __JUDYPP_STRING_MAP_HPP__
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_pointer.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <Judy.h>
+#include <judypp/map_iter.hpp>
+#include <algorithm>
+#include <iterator>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace judypp
+{
+    //! Keys are passed as views, std::string and C strings convert to it
+    typedef boost::string_ref string_key;
+
+    //! true if values of T leave the last byte of the slot free
+    template <typename T>
+    constexpr bool slot_markable() { return sizeof(T) < sizeof(Word_t); }
+
+    //! marks the slot of a present key in its last byte. \return true if it was not marked
+    inline bool mark_slot(PPvoid_t aSlot)
+    {
+        uint8_t& mark = reinterpret_cast<uint8_t*>(aSlot)[sizeof(Word_t) - 1];
+        const bool fresh = 0 == mark;
+        mark = 1;
+        return fresh;
+    }
+
+    //! NUL terminated copy of the key for JudySL, it is on the stack for short keys
+    class sl_key
+    {
+        static const size_t BUF_SIZE = 256;
+
+        uint8_t m_Buf[BUF_SIZE];
+        std::string m_Long;
+        const uint8_t* m_Ptr;
+
+    public:
+        explicit sl_key(string_key aKey)
+        {
+            if (aKey.size() < BUF_SIZE)
+            {
+                memcpy(m_Buf, aKey.data(), aKey.size());
+                m_Buf[aKey.size()] = 0;
+                m_Ptr = m_Buf;
+            }
+            else
+            {
+                m_Long.assign(aKey.data(), aKey.size());
+                m_Ptr = reinterpret_cast<const uint8_t*>(m_Long.c_str());
+            }
+        }
+
+        sl_key(const sl_key&) = delete;
+        sl_key& operator=(const sl_key&) = delete;
+
+        const uint8_t* get() const { return m_Ptr; }
+    };
+
+    // Iterator over JudySL array. Keeps the current key in the buffer sized for the longest
+    // key of the map, m_Value == NULL means end(). Any insertion or deletion invalidates it.
+    class string_map_iterator_base
+    {
+    protected:
+        Pcvoid_t m_Array;
+        std::vector<uint8_t> m_Key;
+        PWord_t m_Value;
+
+    public:
+        // like from end()
+        string_map_iterator_base(Pcvoid_t aArray = NULL, size_t aMaxLen = 0)
+            : m_Array(aArray), m_Key(aMaxLen + 1, 0), m_Value(NULL) {}
+
+        // on the first key >= aKey, or > aKey if aNext is true
+        string_map_iterator_base(Pcvoid_t aArray, size_t aMaxLen, string_key aKey, bool aNext)
+            : m_Array(aArray), m_Key(std::max(aMaxLen, aKey.size()) + 1, 0)
+        {
+            std::copy(aKey.begin(), aKey.end(), m_Key.begin());
+            m_Value = reinterpret_cast<PWord_t>(aNext ? JudySLNext(m_Array, m_Key.data(), PJE0)
+                                                      : JudySLFirst(m_Array, m_Key.data(), PJE0));
+        }
+
+        // on the element of aKey with the value slot, no search
+        string_map_iterator_base(Pcvoid_t aArray, size_t aMaxLen, string_key aKey, PWord_t aValue)
+            : m_Array(aArray), m_Key(std::max(aMaxLen, aKey.size()) + 1, 0), m_Value(aValue)
+        {
+            std::copy(aKey.begin(), aKey.end(), m_Key.begin());
+        }
+
+        bool operator == (const string_map_iterator_base& r) const { return m_Value == r.m_Value; }
+
+        void operator++ ()
+        {
+            m_Value = reinterpret_cast<PWord_t>(JudySLNext(m_Array, m_Key.data(), PJE0));
+        }
+
+        // decrement of end() moves to the last element
+        void operator-- ()
+        {
+            if (NULL == m_Value)
+            {
+                // the greatest string not longer than the buffer
+                std::fill(m_Key.begin(), m_Key.end() - 1, 0xff);
+                m_Key.back() = 0;
+                m_Value = reinterpret_cast<PWord_t>(JudySLLast(m_Array, m_Key.data(), PJE0));
+            }
+            else
+            {
+                m_Value = reinterpret_cast<PWord_t>(JudySLPrev(m_Array, m_Key.data(), PJE0));
+            }
+        }
+
+        //! valid until the iterator is moved
+        string_key key() const { return string_key(reinterpret_cast<const char*>(m_Key.data())); }
+    };
+
+    inline bool operator != (const string_map_iterator_base& l, const string_map_iterator_base& r)
+    {
+        return !(l == r);
+    }
+
+    //! T is mapped_type for iterator and const mapped_type for const_iterator
+    template <typename T>
+    class string_map_iterator : public string_map_iterator_base
+    {
+        typedef string_map_iterator _Mytype;
+        typedef string_map_iterator_base _Mybase;
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, std::pair<const string_key, T&>, ptrdiff_t,
+                map_arrow_proxy<std::pair<const string_key, T&> >, std::pair<const string_key, T&> > __iter_t;
+        typedef typename __iter_t::value_type           value_type;
+        typedef typename __iter_t::difference_type      difference_type;
+        typedef typename __iter_t::pointer              pointer;
+        typedef typename __iter_t::reference            reference;
+        typedef typename __iter_t::iterator_category    iterator_category;
+
+        string_map_iterator(Pcvoid_t aArray = NULL, size_t aMaxLen = 0) : _Mybase(aArray, aMaxLen) {}
+        string_map_iterator(Pcvoid_t aArray, size_t aMaxLen, string_key aKey, bool aNext) : _Mybase(aArray, aMaxLen, aKey, aNext) {}
+        string_map_iterator(Pcvoid_t aArray, size_t aMaxLen, string_key aKey, PWord_t aValue) : _Mybase(aArray, aMaxLen, aKey, aValue) {}
+
+        // iterator -> const_iterator
+        template <typename U>
+        string_map_iterator(const string_map_iterator<U>& r,
+                typename std::enable_if<std::is_convertible<U*, T*>::value>::type* = NULL) : _Mybase(r) {}
+
+        _Mytype& operator++ ()
+        {
+            _Mybase::operator++();
+            return *this;
+        }
+
+        _Mytype operator++ (int)
+        {
+            _Mytype tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        _Mytype& operator-- ()
+        {
+            _Mybase::operator--();
+            return *this;
+        }
+
+        _Mytype operator-- (int)
+        {
+            _Mytype tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        //! key is valid until the iterator is moved
+        reference operator* () const
+        {
+            return reference(key(), *reinterpret_cast<T*>(m_Value));
+        }
+
+        pointer operator-> () const
+        {
+            return pointer{**this};
+        }
+    };
+
+    class StringSet;
+
+    //! Ordered map on JudySL. Keys are strings without '\0', T must be POD.
+    template <typename T>
+    class StringMap
+    {
+        friend class StringSet;
+
+        Pvoid_t m_Array;
+        size_t m_Size;
+        size_t m_MaxLen;
+
+    public:
+        BOOST_STATIC_ASSERT(sizeof(T) <= sizeof(Word_t));
+        BOOST_STATIC_ASSERT(boost::is_integral<T>::value || boost::is_pointer<T>::value);
+
+        typedef string_key key_type;
+        typedef T mapped_type;
+
+        typedef string_map_iterator<T> iterator;
+        typedef string_map_iterator<const T> const_iterator;
+
+        StringMap() : m_Array(NULL), m_Size(0), m_MaxLen(0) {}
+        StringMap(const StringMap& aMap) : StringMap() { for (auto x : aMap) put(x.first) = x.second; }
+        StringMap(StringMap&& aMap) noexcept : m_Array(aMap.m_Array), m_Size(aMap.m_Size), m_MaxLen(aMap.m_MaxLen)
+        {
+            aMap.m_Array = NULL;
+            aMap.m_Size = 0;
+        }
+        ~StringMap() { clear(); }
+        StringMap& operator=(const StringMap& aMap)
+        {
+            if (&aMap != this)
+            {
+                clear();
+                for (auto x : aMap) put(x.first) = x.second;
+            }
+            return *this;
+        }
+        StringMap& operator=(StringMap&& aMap) noexcept
+        {
+            if (&aMap != this)
+            {
+                clear();
+                swap(aMap);
+            }
+            return *this;
+        }
+
+        void swap(StringMap& aMap) noexcept
+        {
+            std::swap(m_Array, aMap.m_Array);
+            std::swap(m_Size, aMap.m_Size);
+            std::swap(m_MaxLen, aMap.m_MaxLen);
+        }
+
+        // own interface
+        //! inserts value by key or searches for existing. \return reference to it
+        mapped_type& put(key_type key) { return *reinterpret_cast<mapped_type*>(ins(key).first); }
+
+        //! searches for the element by key. \return pointer to it or NULL
+        const mapped_type* get(key_type key) const
+        {
+            sl_key k(key);
+            return reinterpret_cast<mapped_type*>(JudySLGet(m_Array, k.get(), PJE0));
+        }
+        mapped_type* get(key_type key) { return const_cast<mapped_type*>(const_cast<const StringMap*>(this)->get(key)); }
+
+        bool del(key_type key)
+        {
+            sl_key k(key);
+            bool r = JudySLDel(&m_Array, k.get(), PJE0);
+            m_Size -= r;
+            return r;
+        }
+
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        void clear()
+        {
+            JudySLFreeArray(&m_Array, PJE0);
+            m_Size = 0;
+            m_MaxLen = 0;
+        }
+
+        // std::map interface
+        //! second is true if the new key is inserted, false if key is already in (value was not changed)
+        std::pair<iterator, bool> insert(const std::pair<key_type, mapped_type>& v)
+        {
+            std::pair<PPvoid_t, bool> r = ins(v.first);
+            if (r.second)
+                *reinterpret_cast<mapped_type*>(r.first) = v.second;
+            return std::make_pair(iterator(m_Array, m_MaxLen, v.first, reinterpret_cast<PWord_t>(r.first)), r.second);
+        }
+
+        //! gets or creates value by the key
+        T& operator[] (key_type k) { return put(k); }
+
+        //! return count of erased keys (0 or 1)
+        size_t erase(key_type k) { return del(k); }
+
+        iterator begin() { return iterator(m_Array, m_MaxLen, key_type(), false); }
+        const_iterator begin() const { return const_iterator(m_Array, m_MaxLen, key_type(), false); }
+        iterator end() { return iterator(m_Array, m_MaxLen); }
+        const_iterator end() const { return const_iterator(m_Array, m_MaxLen); }
+
+        iterator find(key_type k) { iterator it = lower_bound(k); return it != end() && it.key() == k ? it : end(); }
+        const_iterator find(key_type k) const { const_iterator it = lower_bound(k); return it != end() && it.key() == k ? it : end(); }
+
+        //! first element with key >= k
+        iterator lower_bound(key_type k) { return iterator(m_Array, m_MaxLen, k, false); }
+        const_iterator lower_bound(key_type k) const { return const_iterator(m_Array, m_MaxLen, k, false); }
+
+        //! first element with key > k
+        iterator upper_bound(key_type k) { return iterator(m_Array, m_MaxLen, k, true); }
+        const_iterator upper_bound(key_type k) const { return const_iterator(m_Array, m_MaxLen, k, true); }
+
+        //! all elements with keys starting with the prefix
+        std::pair<iterator, iterator> prefix_range(key_type prefix) { return std::make_pair(lower_bound(prefix), prefix_end(prefix)); }
+        std::pair<const_iterator, const_iterator> prefix_range(key_type prefix) const { return std::make_pair(lower_bound(prefix), prefix_end(prefix)); }
+
+    private:
+        /*
+         * \return value slot and true if the key is new
+         * JudySL zeroes new slots but has no population to tell them from old ones holding
+         * zero (Map asks JudyLCount for it). Values narrower than the word are marked in the
+         * last byte of the slot, so one JudySLIns is enough; wider ones are searched for
+         * first and misses cost two descents.
+         */
+        std::pair<PPvoid_t, bool> ins(key_type key)
+        {
+            sl_key k(key);
+            if (!slot_markable<T>())
+            {
+                PPvoid_t v = JudySLGet(m_Array, k.get(), PJE0);
+                if (NULL != v)
+                    return std::make_pair(v, false);
+            }
+            m_MaxLen = std::max(m_MaxLen, key.size());
+            PPvoid_t v = JudySLIns(&m_Array, k.get(), PJE0);
+            const bool inserted = !slot_markable<T>() || mark_slot(v);
+            m_Size += inserted;
+            return std::make_pair(v, inserted);
+        }
+
+        //! first element after all keys with the prefix
+        iterator prefix_end(key_type prefix) const
+        {
+            // the least string greater than all strings with the prefix
+            std::string next(prefix.data(), prefix.size());
+            while (!next.empty() && '\xff' == next.back())
+                next.pop_back();
+            if (next.empty())
+                return iterator(m_Array, m_MaxLen);
+            ++next.back();
+            return iterator(m_Array, m_MaxLen, next, false);
+        }
+    };
+
+    // Iterator over keys of StringSet
+    class string_set_const_iterator : public string_map_iterator_base
+    {
+        typedef string_set_const_iterator _Mytype;
+        typedef string_map_iterator_base _Mybase;
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, const string_key, ptrdiff_t, void, string_key> __iter_t;
+        typedef __iter_t::value_type           value_type;
+        typedef __iter_t::difference_type      difference_type;
+        typedef __iter_t::pointer              pointer;
+        typedef __iter_t::reference            reference;
+        typedef __iter_t::iterator_category    iterator_category;
+
+        string_set_const_iterator(const string_map_iterator_base& r) : _Mybase(r) {}
+
+        _Mytype& operator++ ()
+        {
+            _Mybase::operator++();
+            return *this;
+        }
+
+        _Mytype operator++ (int)
+        {
+            _Mytype tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        _Mytype& operator-- ()
+        {
+            _Mybase::operator--();
+            return *this;
+        }
+
+        _Mytype operator-- (int)
+        {
+            _Mytype tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        //! valid until the iterator is moved
+        reference operator* () const { return key(); }
+    };
+
+    //! Ordered set on JudySL. Keys are strings without '\0'.
+    class StringSet
+    {
+        StringMap<char> m_Map;
+
+    public:
+        typedef string_key key_type;
+        typedef string_key value_type;
+
+        typedef string_set_const_iterator const_iterator;
+
+        //! returns true if new key is added in result of call, otherwise returns false
+        bool set(key_type key) { return m_Map.ins(key).second; }
+
+        //! returns true if key is removed in result of call, otherwise returns false
+        bool unset(key_type key) { return m_Map.del(key); }
+
+        bool test(key_type key) const { return NULL != m_Map.get(key); }
+
+        size_t size() const { return m_Map.size(); }
+
+        bool empty() const { return m_Map.empty(); }
+
+        void clear() { m_Map.clear(); }
+
+        // --- std::set interface ---
+
+        bool insert(key_type v) { return set(v); }
+
+        //! return count of erased keys (0 or 1)
+        size_t erase(key_type k) { return unset(k); }
+
+        const_iterator begin() const { return m_Map.begin(); }
+        const_iterator end()   const { return m_Map.end(); }
+
+        const_iterator find(key_type k) const { return m_Map.find(k); }
+        const_iterator lower_bound(key_type k) const { return m_Map.lower_bound(k); }
+        const_iterator upper_bound(key_type k) const { return m_Map.upper_bound(k); }
+
+        //! all keys starting with the prefix
+        std::pair<const_iterator, const_iterator> prefix_range(key_type prefix) const
+        {
+            auto r = m_Map.prefix_range(prefix);
+            return std::make_pair(const_iterator(r.first), const_iterator(r.second));
+        }
+    };
+
+    //! Unordered map on JudyHS. Keys are arbitrary byte strings, T must be POD.
+    template <typename T>
+    class HashMap
+    {
+        Pvoid_t m_Array;
+        size_t m_Size;
+
+    public:
+        BOOST_STATIC_ASSERT(sizeof(T) <= sizeof(Word_t));
+        BOOST_STATIC_ASSERT(boost::is_integral<T>::value || boost::is_pointer<T>::value);
+
+        typedef string_key key_type;
+        typedef T mapped_type;
+
+        HashMap() : m_Array(NULL), m_Size(0) {}
+        HashMap(HashMap&& aMap) noexcept : m_Array(aMap.m_Array), m_Size(aMap.m_Size)
+        {
+            aMap.m_Array = NULL;
+            aMap.m_Size = 0;
+        }
+        ~HashMap() { clear(); }
+        HashMap& operator=(HashMap&& aMap) noexcept
+        {
+            if (&aMap != this)
+            {
+                clear();
+                std::swap(m_Array, aMap.m_Array);
+                std::swap(m_Size, aMap.m_Size);
+            }
+            return *this;
+        }
+
+        HashMap(const HashMap&) = delete;
+        HashMap& operator=(const HashMap&) = delete;
+
+        //! inserts value by key or searches for existing. \return reference to it
+        //! one JudyHSIns for values narrower than the word, see StringMap::ins
+        mapped_type& put(key_type key)
+        {
+            PPvoid_t v;
+            if (slot_markable<T>())
+            {
+                v = JudyHSIns(&m_Array, ptr(key), key.size(), PJE0);
+                m_Size += mark_slot(v);
+            }
+            else if (NULL == (v = JudyHSGet(m_Array, ptr(key), key.size())))
+            {
+                v = JudyHSIns(&m_Array, ptr(key), key.size(), PJE0);
+                ++m_Size;
+            }
+            return *reinterpret_cast<mapped_type*>(v);
+        }
+
+        //! searches for the element by key. \return pointer to it or NULL
+        const mapped_type* get(key_type key) const { return reinterpret_cast<mapped_type*>(JudyHSGet(m_Array, ptr(key), key.size())); }
+        mapped_type* get(key_type key) { return const_cast<mapped_type*>(const_cast<const HashMap*>(this)->get(key)); }
+
+        bool del(key_type key)
+        {
+            bool r = 1 == JudyHSDel(&m_Array, ptr(key), key.size(), PJE0);
+            m_Size -= r;
+            return r;
+        }
+
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        void clear()
+        {
+            JudyHSFreeArray(&m_Array, PJE0);
+            m_Size = 0;
+        }
+
+        //! gets or creates value by the key
+        T& operator[] (key_type k) { return put(k); }
+
+        //! return count of erased keys (0 or 1)
+        size_t erase(key_type k) { return del(k); }
+
+    private:
+        // JudyHS does not modify the key, but takes non-const pointer
+        static void* ptr(key_type key) { return const_cast<char*>(key.data()); }
+    };
+}// judypp
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_VALUE_STORAGE_HPP__
+#define __JUDYPP_VALUE_STORAGE_HPP__
+
+#include <Judy.h>
+#include <judypp/memory.hpp>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace judypp
+{
+    /*
+     * Pool of objects of type T, memory is returned to the heap by release() only.
+     * With the malloc hooks chunks are counted in allocated_bytes() and are not taken
+     * over the memory limit, std::bad_alloc is thrown then.
+     */
+    template <typename T>
+    class value_pool
+    {
+        union node
+        {
+            node* next;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+        };
+
+        std::vector<std::unique_ptr<node[]> > m_Chunks;
+        node* m_Free;
+        node* m_Pos;
+        node* m_End;
+        size_t m_ChunkSize;
+        size_t m_Bytes;
+        size_t m_Counted;       // bytes added to allocated_bytes()
+
+        static const size_t FIRST_CHUNK_SIZE = 16;
+        static const size_t MAX_CHUNK_SIZE = 4096;
+
+    public:
+        value_pool() : m_Free(NULL), m_Pos(NULL), m_End(NULL), m_ChunkSize(FIRST_CHUNK_SIZE), m_Bytes(0), m_Counted(0) {}
+        value_pool(value_pool&& r) noexcept : value_pool() { swap(r); }
+        value_pool& operator=(value_pool&& r) noexcept
+        {
+            if (&r != this)
+            {
+                release();
+                swap(r);
+            }
+            return *this;
+        }
+
+        void swap(value_pool& r) noexcept
+        {
+            m_Chunks.swap(r.m_Chunks);
+            std::swap(m_Free, r.m_Free);
+            std::swap(m_Pos, r.m_Pos);
+            std::swap(m_End, r.m_End);
+            std::swap(m_ChunkSize, r.m_ChunkSize);
+            std::swap(m_Bytes, r.m_Bytes);
+            std::swap(m_Counted, r.m_Counted);
+        }
+
+        //! constructs T from args in the pool
+        template <typename... Args>
+        T* create(Args&&... args)
+        {
+            node* p = m_Free;
+            if (NULL != p)
+            {
+                m_Free = p->next;
+            }
+            else
+            {
+                if (m_Pos == m_End)
+                {
+                    const size_t bytes = m_ChunkSize * sizeof(node);
+                    const bool counted = malloc_hooks_enabled();
+                    if (counted && !within_memory_limit(bytes))
+                        throw std::bad_alloc();
+                    m_Chunks.emplace_back(new node[m_ChunkSize]);
+                    m_Pos = m_Chunks.back().get();
+                    m_End = m_Pos + m_ChunkSize;
+                    m_Bytes += bytes;
+                    m_ChunkSize = std::min(2 * m_ChunkSize, size_t(MAX_CHUNK_SIZE));
+                    if (counted)
+                    {
+                        allocated_bytes_counter().fetch_add(bytes, std::memory_order_relaxed);
+                        m_Counted += bytes;
+                    }
+                }
+                p = m_Pos++;
+            }
+
+            try
+            {
+                return new (&p->data) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                p->next = m_Free;
+                m_Free = p;
+                throw;
+            }
+        }
+
+        void destroy(T* aValue)
+        {
+            aValue->~T();
+            node* p = reinterpret_cast<node*>(aValue);
+            p->next = m_Free;
+            m_Free = p;
+        }
+
+        //! frees all chunks, objects must be destroyed before
+        void release()
+        {
+            m_Chunks.clear();
+            allocated_bytes_counter().fetch_sub(m_Counted, std::memory_order_relaxed);
+            m_Free = m_Pos = m_End = NULL;
+            m_ChunkSize = FIRST_CHUNK_SIZE;
+            m_Bytes = 0;
+            m_Counted = 0;
+        }
+
+        //! bytes taken from the heap
+        size_t bytes() const { return m_Bytes; }
+    };
+
+    /*
+     * Storage of mapped values in the word slots of JudyL. Small trivially copyable values
+     * are packed into the slot itself, other ones live in the pool owned by the container
+     * and the slot keeps the pointer.
+     */
+    template <typename T, typename Enable = void>
+    struct value_storage
+    {
+        static const bool inplace = false;
+
+        typedef value_pool<T> pool;
+
+        static T& ref(PWord_t slot) { return *reinterpret_cast<T*>(*slot); }
+
+        //! \return word to put into the slot
+        template <typename... Args>
+        static Word_t make(pool& p, Args&&... args) { return reinterpret_cast<Word_t>(p.create(std::forward<Args>(args)...)); }
+
+        //! frees the value of the word which is not in the array anymore
+        static void dispose(pool& p, Word_t w) { p.destroy(reinterpret_cast<T*>(w)); }
+
+        //! walks the array and frees all values before the array is freed
+        static void dispose_all(pool& p, Pcvoid_t aArray)
+        {
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                Word_t i = 0;
+                for (PPvoid_t v = JudyLFirst(aArray, &i, PJE0); NULL != v; v = JudyLNext(aArray, &i, PJE0))
+                    reinterpret_cast<T*>(*reinterpret_cast<PWord_t>(v))->~T();
+            }
+            p.release();
+        }
+
+        static size_t bytes(const pool& p) { return p.bytes(); }
+    };
+
+    template <typename T>
+    struct value_storage<T, typename std::enable_if<sizeof(T) <= sizeof(Word_t) && std::is_trivially_copyable<T>::value>::type>
+    {
+        static const bool inplace = true;
+
+        struct pool {};
+
+        static T& ref(PWord_t slot) { return *reinterpret_cast<T*>(slot); }
+
+        template <typename... Args>
+        static Word_t make(pool&, Args&&... args)
+        {
+            const T v = T(std::forward<Args>(args)...);
+            Word_t w = 0;
+            memcpy(&w, &v, sizeof(T));
+            return w;
+        }
+
+        static void dispose(pool&, Word_t) {}
+
+        static void dispose_all(pool&, Pcvoid_t) {}
+
+        static size_t bytes(const pool&) { return 0; }
+    };
+}// judypp
+
+#endif
@@ -0,0 +1,451 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#ifndef __JUDYPP_WIDE_MAP_HPP__
+#define __JUDYPP_WIDE_MAP_HPP__
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_pointer.hpp>
+#include <Judy.h>
+#include <judypp/map_iter.hpp>
+#include <iterator>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace judypp
+{
+    /*
+     * Maps a key to N words, the order of keys is the lexicographic order of the words.
+     * By default the words are the bytes of the key in the order of memory, the last one is
+     * padded by zeros. So keys of whole unsigned words are ordered by fields, but narrower
+     * fields, byte arrays (UUIDs) and integers wider than a word are not ordered by value
+     * on little-endian machines. Keys with padding bytes are rejected, as equal keys could
+     * differ in them. Specialize wide_key_traits for such keys or for other order.
+     */
+    template <typename Key, typename Enable = void>
+    struct wide_key_traits
+    {
+        BOOST_STATIC_ASSERT_MSG(__has_unique_object_representations(Key),
+                "key has padding or several representations of a value, specialize wide_key_traits for it");
+
+        static const size_t N = (sizeof(Key) + sizeof(Word_t) - 1) / sizeof(Word_t);
+
+        static void encode(const Key& k, Word_t* w) { memcpy(w, &k, sizeof(Key)); }
+
+        static Key decode(const Word_t* w)
+        {
+            Key k;
+            memcpy(&k, w, sizeof(Key));
+            return k;
+        }
+    };
+
+#ifdef __SIZEOF_INT128__
+    //! 128-bit integers go by value: the high word first, the sign bit is flipped like in key_traits
+    template <typename Key>
+    struct wide_key_traits<Key, typename std::enable_if<std::is_same<Key, __int128>::value || std::is_same<Key, unsigned __int128>::value>::type>
+    {
+        static const size_t N = 2;
+        static const Word_t SIGN_BIT = std::is_same<Key, __int128>::value ? Word_t(1) << 63 : 0;
+
+        static void encode(const Key& k, Word_t* w)
+        {
+            w[0] = Word_t((unsigned __int128)k >> 64) ^ SIGN_BIT;
+            w[1] = Word_t(k);
+        }
+
+        static Key decode(const Word_t* w) { return Key((unsigned __int128)(w[0] ^ SIGN_BIT) << 64 | w[1]); }
+    };
+#endif
+
+    //! Words of the key by wide_key_traits
+    template <typename Key>
+    struct wide_key
+    {
+        static const size_t N = wide_key_traits<Key>::N;
+
+        Word_t w[N];
+
+        wide_key() { memset(w, 0, sizeof(w)); }
+        explicit wide_key(const Key& k) : wide_key() { wide_key_traits<Key>::encode(k, w); }
+
+        Key key() const { return wide_key_traits<Key>::decode(w); }
+    };
+
+    // Iterator over nested JudyL arrays, one level per word of the key. Holds the path to the
+    // current element, m_Value == NULL means end(). Any insertion or deletion invalidates it.
+    template <typename Key>
+    class wide_map_iterator_base
+    {
+    protected:
+        static const size_t N = wide_key<Key>::N;
+
+        Pcvoid_t m_Arrays[N];
+        wide_key<Key> m_Key;
+        PWord_t m_Value;
+
+        /*
+         * Moves forward (or backward) to the nearest element from m_Key.w[level..N) within
+         * m_Arrays[level], to the nearest with other index on this level if aStep is true.
+         * Lower levels keep their bound only while the upper indexes match the key.
+         * When a level is exhausted the walk steps on the upper one.
+         */
+        void walk(size_t level, bool aStep, bool aForward)
+        {
+            bool bound = !aStep;
+            for (;;)
+            {
+                const Word_t want = m_Key.w[level];
+                PPvoid_t v;
+                if (aForward)
+                    v = aStep ? JudyLNext(m_Arrays[level], &m_Key.w[level], PJE0) : JudyLFirst(m_Arrays[level], &m_Key.w[level], PJE0);
+                else
+                    v = aStep ? JudyLPrev(m_Arrays[level], &m_Key.w[level], PJE0) : JudyLLast(m_Arrays[level], &m_Key.w[level], PJE0);
+
+                if (NULL == v)
+                {
+                    if (0 == level)
+                    {
+                        m_Value = NULL;
+                        return;
+                    }
+                    --level;
+                    aStep = true;
+                    continue;
+                }
+
+                if (aStep || m_Key.w[level] != want)
+                    bound = false;
+                if (N - 1 == level)
+                {
+                    m_Value = reinterpret_cast<PWord_t>(v);
+                    return;
+                }
+                m_Arrays[++level] = *v;
+                aStep = false;
+                if (!bound)
+                    m_Key.w[level] = aForward ? 0 : -1;
+            }
+        }
+
+    public:
+        // like from end()
+        wide_map_iterator_base(Pcvoid_t aRoot = NULL) : m_Value(NULL) { m_Arrays[0] = aRoot; }
+
+        // on the nearest element from aKey forward or backward
+        wide_map_iterator_base(Pcvoid_t aRoot, const wide_key<Key>& aKey, bool aForward) : m_Key(aKey)
+        {
+            m_Arrays[0] = aRoot;
+            walk(0, false, aForward);
+        }
+
+        bool operator == (const wide_map_iterator_base& r) const { return m_Value == r.m_Value; }
+        bool operator != (const wide_map_iterator_base& r) const { return m_Value != r.m_Value; }
+
+        void operator++ () { walk(N - 1, true, true); }
+
+        // decrement of end() moves to the last element
+        void operator-- ()
+        {
+            if (NULL == m_Value)
+            {
+                memset(m_Key.w, 0xff, sizeof(m_Key.w));
+                walk(0, false, false);
+            }
+            else
+            {
+                walk(N - 1, true, false);
+            }
+        }
+
+        //! words of the current key
+        const wide_key<Key>& words() const { return m_Key; }
+    };
+
+    //! T is mapped_type for iterator and const mapped_type for const_iterator
+    template <typename Key, typename T>
+    class wide_map_iterator : public wide_map_iterator_base<Key>
+    {
+        typedef wide_map_iterator _Mytype;
+        typedef wide_map_iterator_base<Key> _Mybase;
+
+    public:
+        typedef std::iterator<std::bidirectional_iterator_tag, std::pair<const Key, T&>, ptrdiff_t,
+                map_arrow_proxy<std::pair<const Key, T&> >, std::pair<const Key, T&> > __iter_t;
+        typedef typename __iter_t::value_type           value_type;
+        typedef typename __iter_t::difference_type      difference_type;
+        typedef typename __iter_t::pointer              pointer;
+        typedef typename __iter_t::reference            reference;
+        typedef typename __iter_t::iterator_category    iterator_category;
+
+        wide_map_iterator(Pcvoid_t aRoot = NULL) : _Mybase(aRoot) {}
+        wide_map_iterator(Pcvoid_t aRoot, const wide_key<Key>& aKey, bool aForward) : _Mybase(aRoot, aKey, aForward) {}
+
+        // iterator -> const_iterator
+        template <typename U>
+        wide_map_iterator(const wide_map_iterator<Key, U>& r,
+                typename std::enable_if<std::is_convertible<U*, T*>::value>::type* = NULL) : _Mybase(r) {}
+
+        _Mytype& operator++ ()
+        {
+            _Mybase::operator++();
+            return *this;
+        }
+
+        _Mytype operator++ (int)
+        {
+            _Mytype tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        _Mytype& operator-- ()
+        {
+            _Mybase::operator--();
+            return *this;
+        }
+
+        _Mytype operator-- (int)
+        {
+            _Mytype tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        reference operator* () const
+        {
+            return reference(this->m_Key.key(), *reinterpret_cast<T*>(this->m_Value));
+        }
+
+        pointer operator-> () const
+        {
+            return pointer{**this};
+        }
+    };
+
+    /*
+     * Map with trivially copyable keys of any size. The key is split into machine words and
+     * each word is a level of nested JudyL arrays, the last level keeps values. Inner arrays
+     * are created and freed automatically. Elements are ordered lexicographically by words
+     * of the key (see wide_key_traits), so structs of unsigned words like
+     * {tenant_id, object_id} are ordered by fields.
+     *
+     * T must be POD like in Map.
+     */
+    template <typename Key, typename T>
+    class WideMap
+    {
+        typedef wide_key<Key> words_type;
+        static const size_t N = words_type::N;
+
+        Pvoid_t m_Root;
+        size_t m_Size;
+
+    public:
+        BOOST_STATIC_ASSERT(std::is_trivially_copyable<Key>::value);
+        BOOST_STATIC_ASSERT(sizeof(T) <= sizeof(Word_t));
+        BOOST_STATIC_ASSERT(boost::is_integral<T>::value || boost::is_pointer<T>::value);
+
+        typedef Key key_type;
+        typedef T mapped_type;
+        typedef std::pair<const Key, T> value_type;
+
+        typedef wide_map_iterator<Key, T> iterator;
+        typedef wide_map_iterator<Key, const T> const_iterator;
+
+        WideMap() : m_Root(NULL), m_Size(0) {}
+        WideMap(const WideMap& aMap) : WideMap() { for (auto x : aMap) put(x.first) = x.second; }
+        WideMap(WideMap&& aMap) noexcept : m_Root(aMap.m_Root), m_Size(aMap.m_Size)
+        {
+            aMap.m_Root = NULL;
+            aMap.m_Size = 0;
+        }
+        ~WideMap() { clear(); }
+        WideMap& operator=(const WideMap& aMap)
+        {
+            if (&aMap != this)
+            {
+                clear();
+                for (auto x : aMap) put(x.first) = x.second;
+            }
+            return *this;
+        }
+        WideMap& operator=(WideMap&& aMap) noexcept
+        {
+            if (&aMap != this)
+            {
+                clear();
+                swap(aMap);
+            }
+            return *this;
+        }
+
+        void swap(WideMap& aMap) noexcept
+        {
+            std::swap(m_Root, aMap.m_Root);
+            std::swap(m_Size, aMap.m_Size);
+        }
+
+        // own interface
+        //! inserts value by key or searches for existing. \return reference to it
+        mapped_type& put(const key_type& key) { return *reinterpret_cast<mapped_type*>(ins(words_type(key)).first); }
+
+        //! searches for the element by key. \return pointer to it or NULL
+        const mapped_type* get(const key_type& key) const
+        {
+            const words_type k(key);
+            Pcvoid_t a = m_Root;
+            PPvoid_t v = NULL;
+            for (size_t i = 0; i < N; ++i)
+            {
+                if (NULL == (v = JudyLGet(a, k.w[i], PJE0)))
+                    return NULL;
+                a = *v;
+            }
+            return reinterpret_cast<mapped_type*>(v);
+        }
+        mapped_type* get(const key_type& key) { return const_cast<mapped_type*>(const_cast<const WideMap*>(this)->get(key)); }
+
+        //! empty inner arrays are removed from the upper levels
+        bool del(const key_type& key)
+        {
+            const words_type k(key);
+            PPvoid_t path[N];
+            path[0] = &m_Root;
+            for (size_t i = 1; i < N; ++i)
+                if (NULL == (path[i] = JudyLGet(*path[i - 1], k.w[i - 1], PJE0)))
+                    return false;
+
+            if (0 == JudyLDel(path[N - 1], k.w[N - 1], PJE0))
+                return false;
+            for (size_t i = N - 1; i > 0 && NULL == *path[i]; --i)
+                JudyLDel(path[i - 1], k.w[i - 1], PJE0);
+            --m_Size;
+            return true;
+        }
+
+        size_t size() const { return m_Size; }
+
+        bool empty() const { return 0 == m_Size; }
+
+        void clear()
+        {
+            free_level(&m_Root, 0);
+            m_Size = 0;
+        }
+
+        // std::map interface
+        //! second is true if the new key is inserted, false if key is already in (value was not changed)
+        std::pair<iterator, bool> insert(const value_type& v)
+        {
+            std::pair<PPvoid_t, bool> r = ins(words_type(v.first));
+            if (r.second)
+                *reinterpret_cast<mapped_type*>(r.first) = v.second;
+            return std::make_pair(find(v.first), r.second);
+        }
+
+        //! gets or creates value by the key
+        T& operator[] (const key_type& k) { return put(k); }
+
+        //! return count of erased keys (0 or 1)
+        size_t erase(const key_type& k) { return del(k); }
+
+        iterator begin() { return iterator(m_Root, words_type(), true); }
+        const_iterator begin() const { return const_iterator(m_Root, words_type(), true); }
+        iterator end() { return iterator(m_Root); }
+        const_iterator end() const { return const_iterator(m_Root); }
+
+        iterator find(const key_type& k) { iterator it = lower_bound(k); return it != end() && equal(it.words(), words_type(k)) ? it : end(); }
+        const_iterator find(const key_type& k) const { const_iterator it = lower_bound(k); return it != end() && equal(it.words(), words_type(k)) ? it : end(); }
+
+        //! first element with key >= k
+        iterator lower_bound(const key_type& k) { return iterator(m_Root, words_type(k), true); }
+        const_iterator lower_bound(const key_type& k) const { return const_iterator(m_Root, words_type(k), true); }
+
+        //! first element with key > k
+        iterator upper_bound(const key_type& k) { iterator it = lower_bound(k); return it != end() && equal(it.words(), words_type(k)) ? ++it : it; }
+        const_iterator upper_bound(const key_type& k) const { const_iterator it = lower_bound(k); return it != end() && equal(it.words(), words_type(k)) ? ++it : it; }
+
+        //! all elements whose first aWords words of the key match the ones of k,
+        //! aWords over the words of the key is taken as the whole key
+        std::pair<iterator, iterator> prefix_range(const key_type& k, size_t aWords)
+        {
+            if (aWords > N)
+                aWords = N;
+            words_type first(k);
+            for (size_t i = aWords; i < N; ++i)
+                first.w[i] = 0;
+            std::pair<words_type, bool> r = prefix_bounds(first, aWords);
+            return std::make_pair(iterator(m_Root, first, true), r.second ? iterator(m_Root, r.first, true) : end());
+        }
+        std::pair<const_iterator, const_iterator> prefix_range(const key_type& k, size_t aWords) const
+        {
+            return const_cast<WideMap*>(this)->prefix_range(k, aWords);
+        }
+
+    private:
+        static bool equal(const words_type& l, const words_type& r) { return 0 == memcmp(l.w, r.w, sizeof(l.w)); }
+
+        //! \return value slot and true if the key is new
+        std::pair<PPvoid_t, bool> ins(const words_type& k)
+        {
+            PPvoid_t a = &m_Root;
+            bool fresh = false;
+            for (size_t i = 0; i < N - 1; ++i)
+            {
+                fresh = fresh || NULL == *a;
+                a = JudyLIns(a, k.w[i], PJE0);
+            }
+            fresh = fresh || NULL == *a;
+
+            // the key is new if the last level grows
+            const Word_t before = fresh ? 0 : JudyLCount(*a, 0, -1, PJE0);
+            PPvoid_t v = JudyLIns(a, k.w[N - 1], PJE0);
+            const bool inserted = fresh || (NULL == *v && before != JudyLCount(*a, 0, -1, PJE0));
+            m_Size += inserted;
+            return std::make_pair(v, inserted);
+        }
+
+        //! the first key after all keys with the prefix of aWords words and false if there is no such
+        static std::pair<words_type, bool> prefix_bounds(words_type next, size_t aWords)
+        {
+            for (size_t i = aWords; i > 0; --i)
+                if (0 != ++next.w[i - 1])
+                    return std::make_pair(next, true);
+            return std::make_pair(next, false);
+        }
+
+        static void free_level(PPvoid_t a, size_t level)
+        {
+            if (N - 1 != level)
+            {
+                Word_t i = 0;
+                for (PPvoid_t v = JudyLFirst(*a, &i, PJE0); NULL != v; v = JudyLNext(*a, &i, PJE0))
+                    free_level(v, level + 1);
+            }
+            JudyLFreeArray(a, PJE0);
+        }
+    };
+}// judypp
+
+#endif
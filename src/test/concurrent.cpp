@@ -0,0 +1,107 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#include <judypp/concurrent.hpp>
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+BOOST_AUTO_TEST_CASE(test_concurrent)
+{
+    judypp::ConcurrentMap<long, long> cm;
+    BOOST_CHECK_EQUAL(true, cm.read()->empty());
+
+    cm.update([] (judypp::Map<long, long>& m) { m.put(1) = 10; });
+    cm.update([] (judypp::Map<long, long>& m) { m.put(2) = 20; });
+    BOOST_CHECK_EQUAL(2u, cm.pending());
+
+    // publish waits for the pinned reader, whose snapshot does not change
+    auto r = cm.read();
+    BOOST_CHECK_EQUAL(true, r->empty());
+    std::thread writer([&] { cm.publish(); });
+    while (0 != cm.pending())
+        std::this_thread::yield();
+    BOOST_CHECK_EQUAL(true, r->empty());
+    {
+        auto r2 = std::move(r);
+        BOOST_CHECK_EQUAL(true, r2->empty());
+    }
+    writer.join();
+
+    BOOST_CHECK_EQUAL(2u, cm.read()->size());
+    BOOST_CHECK_EQUAL(20, *cm.read()->get(2));
+
+    cm.publish([] (judypp::Map<long, long>& m) { m.del(1); });
+    BOOST_CHECK_EQUAL(1u, cm.read()->size());
+
+    judypp::Set<int> s;
+    s.set(5);
+    judypp::ConcurrentSet<int> cs(std::move(s));
+    BOOST_CHECK_EQUAL(true, cs.read()->test(5));
+    cs.publish();
+    BOOST_CHECK_EQUAL(1u, cs.read()->size());
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_readers)
+{
+    // every snapshot keeps the count of its keys by key 0
+    judypp::ConcurrentMap<long, long> cm;
+    cm.publish([] (judypp::Map<long, long>& m) { m.put(0) = 1; });
+
+    std::atomic<bool> stop(false);
+    std::atomic<long> bad(0), reads(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+        readers.emplace_back([&]
+                {
+                    // at least one read even if all updates are published before the start
+                    do
+                    {
+                        auto r = cm.read();
+                        const long* n = r->get(0);
+                        if (NULL == n || static_cast<size_t>(*n) != r->size())
+                            ++bad;
+                        ++reads;
+                    }
+                    while (!stop);
+                });
+
+    for (long v = 1; v < 200; ++v)
+        cm.publish([v] (judypp::Map<long, long>& m)
+                {
+                    m.put(v);
+                    m.put(0) = m.size();
+                });
+    stop = true;
+    for (auto& t : readers)
+        t.join();
+
+    BOOST_CHECK_EQUAL(0, bad.load());
+    BOOST_CHECK_LT(0, reads.load());
+    BOOST_CHECK_EQUAL(200u, cm.read()->size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+
+#include <judypp/hybrid_set.hpp>
+#include <boost/mpl/list.hpp>
+#include <boost/test/unit_test.hpp>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+typedef judypp::hybrid_chunk chunk;
+
+typedef boost::mpl::list<long, unsigned int, unsigned long> hybrid_types_t;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_hybrid_set, T, hybrid_types_t)
+{
+    judypp::HybridSet<T> js;
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK(js.begin() == js.end());
+    BOOST_CHECK_EQUAL(true, js.set(T(5)));
+    BOOST_CHECK_EQUAL(false, js.set(T(5)));
+    BOOST_CHECK_EQUAL(true, js.set(T(70000)));
+    BOOST_CHECK_EQUAL(true, js.insert(T(3)));
+    BOOST_CHECK_EQUAL(3u, js.size());
+    BOOST_CHECK_EQUAL(true, js.test(T(70000)));
+    BOOST_CHECK_EQUAL(false, js.test(T(4)));
+    BOOST_CHECK_EQUAL(2u, js.chunks(chunk::ARRAY));
+
+    BOOST_CHECK((std::vector<T>{T(3), T(5), T(70000)}) == std::vector<T>(js.begin(), js.end()));
+    BOOST_CHECK_EQUAL(T(5), *js.find(T(5)));
+    BOOST_CHECK(js.find(T(4)) == js.end());
+    BOOST_CHECK_EQUAL(T(5), *js.lower_bound(T(4)));
+    BOOST_CHECK_EQUAL(T(70000), *js.upper_bound(T(5)));
+    BOOST_CHECK(js.upper_bound(T(70000)) == js.end());
+    BOOST_CHECK_EQUAL(T(70000), *--js.end());
+
+    auto it = js.find(T(70000));
+    --it;
+    BOOST_CHECK_EQUAL(T(5), *it);
+
+    BOOST_CHECK_EQUAL(true, js.unset(T(70000)));
+    BOOST_CHECK_EQUAL(false, js.unset(T(70000)));
+    BOOST_CHECK_EQUAL(1u, js.erase(T(3)));
+    BOOST_CHECK_EQUAL(1u, js.size());
+    BOOST_CHECK_EQUAL(1u, js.chunks(chunk::ARRAY));
+
+    judypp::HybridSet<T> copy(js);
+    js.clear();
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK_EQUAL(true, copy.test(T(5)));
+    judypp::HybridSet<T> moved(std::move(copy));
+    BOOST_CHECK_EQUAL(true, copy.empty());
+    BOOST_CHECK_EQUAL(1u, moved.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_hybrid_set_signed_order)
+{
+    judypp::HybridSet<long> js;
+    for (long k : {3L, -1L, -100000L, 0L, 100000L})
+        js.set(k);
+    BOOST_CHECK((std::vector<long>{-100000L, -1L, 0L, 3L, 100000L}) == std::vector<long>(js.begin(), js.end()));
+}
+
+BOOST_AUTO_TEST_CASE(test_hybrid_set_forms)
+{
+    judypp::HybridSet<unsigned long> js;
+
+    // consecutive ids become runs
+    for (unsigned long i = 0; i < 60000; ++i)
+        js.set(i);
+    BOOST_CHECK_EQUAL(1u, js.chunks(chunk::RUN));
+    BOOST_CHECK_LT(js.memory_usage(), 1000u);
+
+    // every other id is a bitmap
+    for (unsigned long i = 65536; i < 2 * 65536; i += 2)
+        js.set(i);
+    BOOST_CHECK_EQUAL(1u, js.chunks(chunk::BITMAP));
+
+    // sparse ids are an array
+    for (unsigned long i = 0; i < 100; ++i)
+        js.set(10 * 65536 + i * 97);
+    BOOST_CHECK_EQUAL(1u, js.chunks(chunk::ARRAY));
+
+    // holes in runs turn them to the bitmap, removal of the most of bits gives the array
+    for (unsigned long i = 0; i < 60000; i += 3)
+        js.unset(i);
+    BOOST_CHECK_EQUAL(0u, js.chunks(chunk::RUN));
+    BOOST_CHECK_EQUAL(2u, js.chunks(chunk::BITMAP));
+    for (unsigned long i = 65536; i < 2 * 65536 - 200; i += 2)
+        js.unset(i);
+    BOOST_CHECK_EQUAL(2u, js.chunks(chunk::ARRAY));
+    BOOST_CHECK_EQUAL(40000u + 100 + 100, js.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_hybrid_set_random)
+{
+    // random changes in all forms against std::set
+    std::mt19937_64 rnd(42);
+    judypp::HybridSet<unsigned long> js;
+    std::set<unsigned long> ref;
+    for (int round = 0; round < 4; ++round)
+    {
+        const unsigned long span = round % 2 ? 3 * 65536 : 20000;
+        for (int i = 0; i < 100000; ++i)
+        {
+            // runs of random length
+            const unsigned long k = rnd() % span, n = 1 + rnd() % 20;
+            const bool add = rnd() % 3 != 0;
+            for (unsigned long j = k; j < k + n; ++j)
+            {
+                if (add)
+                    BOOST_REQUIRE_EQUAL(ref.insert(j).second, js.set(j));
+                else
+                    BOOST_REQUIRE_EQUAL(ref.erase(j), size_t(js.unset(j)));
+            }
+        }
+        BOOST_REQUIRE_EQUAL(ref.size(), js.size());
+        BOOST_REQUIRE(std::vector<unsigned long>(ref.begin(), ref.end()) == std::vector<unsigned long>(js.begin(), js.end()));
+
+        std::vector<unsigned long> back;
+        for (auto it = js.end(); it != js.begin();)
+            back.push_back(*--it);
+        BOOST_REQUIRE(std::vector<unsigned long>(ref.rbegin(), ref.rend()) == back);
+
+        for (int i = 0; i < 10000; ++i)
+        {
+            const unsigned long k = rnd() % (span + 10);
+            BOOST_REQUIRE_EQUAL(ref.count(k), size_t(js.test(k)));
+            auto r = ref.lower_bound(k);
+            auto h = js.lower_bound(k);
+            BOOST_REQUIRE_EQUAL(r == ref.end(), h == js.end());
+            if (r != ref.end())
+                BOOST_REQUIRE_EQUAL(*r, *h);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -20,8 +20,12 @@
  */
 
 #include <judypp/map.hpp>
+#include <algorithm>
 #include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
+#include <memory>
+#include <string>
+#include <vector>
 
 using namespace boost::unit_test;
 
@@ -62,6 +66,22 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_size_empty_clear, TPair, map_types_t)
     BOOST_CHECK_EQUAL(false, js.empty());
     BOOST_CHECK_EQUAL(2u, js.size());
 
+    // existing key with zero value is not counted twice
+    js.put(KeyT(1));
+    BOOST_CHECK_EQUAL(2u, js.size());
+    js.put(KeyT(1)) = ValT(5);
+    js.put(KeyT(1));
+    BOOST_CHECK_EQUAL(2u, js.size());
+
+    BOOST_CHECK_EQUAL(2u, js.count(KeyT(0), KeyT(1)));
+    BOOST_CHECK_EQUAL(1u, js.count(KeyT(1), KeyT(10)));
+    BOOST_CHECK_EQUAL(0u, js.count(KeyT(2), KeyT(10)));
+
+    js.del(KeyT(0));
+    BOOST_CHECK_EQUAL(1u, js.size());
+    js.del(KeyT(0));
+    BOOST_CHECK_EQUAL(1u, js.size());
+
     js.clear();
     BOOST_CHECK_EQUAL(true, js.empty());
     BOOST_CHECK_EQUAL(0u, js.size());
@@ -130,12 +150,12 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_map, TPair, map_types_t)
     BOOST_CHECK_EQUAL(np, js.get(KeyT(1)));
 
     //std::map interface
-    BOOST_CHECK_EQUAL(true, js.insert(std::make_pair(KeyT(3), ValT(1))));
+    BOOST_CHECK_EQUAL(true, js.insert(std::make_pair(KeyT(3), ValT(1))).second);
     BOOST_CHECK_EQUAL(1u, js.size());
     BOOST_REQUIRE_NE (np, js.get(KeyT(3)));
     BOOST_CHECK_EQUAL(ValT(1), *js.get(KeyT(3)));
 
-    BOOST_CHECK_EQUAL(false, js.insert(std::make_pair(KeyT(3), ValT(5))));
+    BOOST_CHECK_EQUAL(false, js.insert(std::make_pair(KeyT(3), ValT(5))).second);
     BOOST_CHECK_EQUAL(1u, js.size());
     BOOST_REQUIRE_NE (np, js.get(KeyT(3)));
     BOOST_CHECK_EQUAL(ValT(1), *js.get(KeyT(3)));
@@ -150,6 +170,431 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_map, TPair, map_types_t)
     BOOST_CHECK_EQUAL(1u, js.erase(KeyT(3)));
     BOOST_CHECK_EQUAL(1u, js.size());
     BOOST_CHECK_EQUAL(0u, js.erase(KeyT(3)));
+
+    auto r = js.insert(std::make_pair(KeyT(4), ValT(0)));
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_REQUIRE(r.first != js.end());
+    BOOST_CHECK_EQUAL(KeyT(4), r.first->first);
+    BOOST_CHECK_EQUAL(2u, js.size());
+    r = js.insert(std::make_pair(KeyT(4), ValT(6)));
+    BOOST_CHECK_EQUAL(false, r.second);
+    BOOST_CHECK_EQUAL(ValT(0), r.first->second);
+    BOOST_CHECK_EQUAL(2u, js.size());
+
+    r = js.try_emplace(KeyT(4), ValT(6));
+    BOOST_CHECK_EQUAL(false, r.second);
+    BOOST_CHECK_EQUAL(ValT(0), *js.get(KeyT(4)));
+    r = js.try_emplace(KeyT(5), ValT(6));
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_CHECK_EQUAL(ValT(6), *js.get(KeyT(5)));
+    BOOST_CHECK_EQUAL(3u, js.size());
+
+    r = js.insert_or_assign(KeyT(5), ValT(7));
+    BOOST_CHECK_EQUAL(false, r.second);
+    BOOST_CHECK_EQUAL(ValT(7), r.first->second);
+    r = js.insert_or_assign(KeyT(6), ValT(8));
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_CHECK_EQUAL(ValT(8), *js.get(KeyT(6)));
+    BOOST_CHECK_EQUAL(4u, js.size());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_iters, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    typedef judypp::Map<KeyT, ValT> map_t;
+
+    // check for empty
+    map_t js;
+    const map_t& cjs = js;
+    BOOST_CHECK(js.begin() == js.end());
+    BOOST_CHECK(cjs.begin() == cjs.end());
+    BOOST_CHECK(js.find(KeyT(0)) == js.end());
+    BOOST_CHECK(js.lower_bound(KeyT(0)) == js.end());
+    BOOST_CHECK(js.upper_bound(KeyT(0)) == js.end());
+
+    js.put(KeyT(0)) = ValT(1);
+    js.put(KeyT(10)) = ValT(2);
+    js.put(KeyT(29)) = ValT(3);
+
+    // check ++ and --
+    auto it = js.begin();
+    BOOST_REQUIRE(it != js.end());
+    BOOST_CHECK_EQUAL(it->first, KeyT(0));
+    BOOST_CHECK_EQUAL(it->second, ValT(1));
+    ++it;
+    BOOST_CHECK_EQUAL((*it).first, KeyT(10));
+    BOOST_CHECK_EQUAL((*it).second, ValT(2));
+    it++;
+    BOOST_CHECK_EQUAL(it->first, KeyT(29));
+    it--;
+    BOOST_CHECK_EQUAL(it->first, KeyT(10));
+    ++it; ++it;
+    BOOST_CHECK(it == js.end());
+    --it;
+    BOOST_CHECK_EQUAL(it->first, KeyT(29));
+
+    // check values are writable through iterator
+    js.begin()->second = ValT(7);
+    BOOST_CHECK_EQUAL(ValT(7), *js.get(KeyT(0)));
+
+    // check range-for and const_iterator
+    size_t n = 0;
+    for (auto x : cjs)
+    {
+        BOOST_CHECK_EQUAL(*js.get(x.first), x.second);
+        ++n;
+    }
+    BOOST_CHECK_EQUAL(n, js.size());
+    typename map_t::const_iterator cit = js.begin();
+    BOOST_CHECK(cit == cjs.begin());
+
+    // check find and bounds
+    BOOST_CHECK(js.find(KeyT(10)) != js.end());
+    BOOST_CHECK_EQUAL(js.find(KeyT(10))->second, ValT(2));
+    BOOST_CHECK(js.find(KeyT(15)) == js.end());
+    BOOST_CHECK_EQUAL(js.lower_bound(KeyT(10))->first, KeyT(10));
+    BOOST_CHECK_EQUAL(js.lower_bound(KeyT(11))->first, KeyT(29));
+    BOOST_CHECK_EQUAL(js.upper_bound(KeyT(10))->first, KeyT(29));
+    BOOST_CHECK(js.upper_bound(KeyT(29)) == js.end());
+    BOOST_CHECK(js.lower_bound(KeyT(30)) == js.end());
+
+    auto r = js.equal_range(KeyT(10));
+    BOOST_CHECK(r.first == js.find(KeyT(10)));
+    BOOST_CHECK(r.second == js.find(KeyT(29)));
+    r = js.equal_range(KeyT(11));
+    BOOST_CHECK(r.first == r.second);
+
+    js.erase(js.begin());
+    BOOST_CHECK_EQUAL(2u, js.size());
+    BOOST_CHECK_EQUAL(js.begin()->first, KeyT(10));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_bulk, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    typedef judypp::Map<KeyT, ValT> map_t;
+    typedef std::pair<KeyT, ValT> pair_t;
+
+    std::vector<pair_t> sorted = {pair_t(KeyT(1), ValT(10)), pair_t(KeyT(2), ValT(20)), pair_t(KeyT(30), ValT(0))};
+    std::vector<pair_t> unsorted = {pair_t(KeyT(5), ValT(1)), pair_t(KeyT(3), ValT(2)), pair_t(KeyT(5), ValT(3))};
+
+    map_t js;
+    js.assign_sorted(sorted.begin(), sorted.end());
+    BOOST_CHECK_EQUAL(3u, js.size());
+    auto it = js.begin();
+    for (auto& p : sorted)
+    {
+        BOOST_REQUIRE(it != js.end());
+        BOOST_CHECK_EQUAL(p.first, it->first);
+        BOOST_CHECK_EQUAL(p.second, it->second);
+        ++it;
+    }
+
+    // into non-empty map existing values are kept
+    js.insert(unsorted.begin(), unsorted.end());
+    BOOST_CHECK_EQUAL(5u, js.size());
+    BOOST_CHECK_EQUAL(ValT(1), *js.get(KeyT(5)));
+    BOOST_CHECK_EQUAL(ValT(10), *js.get(KeyT(1)));
+
+    // assign replaces content, unsorted input takes the slow path
+    js.assign_sorted(unsorted.begin(), unsorted.end());
+    BOOST_CHECK_EQUAL(2u, js.size());
+    BOOST_CHECK_EQUAL(ValT(1), *js.get(KeyT(5)));
+    BOOST_CHECK_EQUAL(np, js.get(KeyT(1)));
+
+    // from another map
+    map_t copy;
+    copy.insert(js.begin(), js.end());
+    BOOST_CHECK_EQUAL(2u, copy.size());
+    BOOST_CHECK_EQUAL(ValT(2), *copy.get(KeyT(3)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_copy_move, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    typedef judypp::Map<KeyT, ValT> map_t;
+
+    map_t js;
+    js.put(KeyT(1)) = ValT(10);
+    js.put(KeyT(7)) = ValT(70);
+
+    map_t copy(js);
+    BOOST_CHECK_EQUAL(2u, copy.size());
+    BOOST_CHECK_EQUAL(ValT(70), *copy.get(KeyT(7)));
+    copy.put(KeyT(7)) = ValT(5);
+    BOOST_CHECK_EQUAL(ValT(70), *js.get(KeyT(7)));
+
+    copy = js;
+    BOOST_CHECK_EQUAL(ValT(70), *copy.get(KeyT(7)));
+
+    map_t moved(std::move(copy));
+    BOOST_CHECK_EQUAL(2u, moved.size());
+    BOOST_CHECK_EQUAL(ValT(10), *moved.get(KeyT(1)));
+    BOOST_CHECK_EQUAL(true, copy.empty());
+    BOOST_CHECK(copy.begin() == copy.end());
+
+    copy.put(KeyT(3));
+    copy = std::move(moved);
+    BOOST_CHECK_EQUAL(2u, copy.size());
+    BOOST_CHECK_EQUAL(np, copy.get(KeyT(3)));
+    BOOST_CHECK_EQUAL(true, moved.empty());
+
+    std::vector<map_t> v(3);
+    v[1] = js;
+    v.resize(100);
+    BOOST_CHECK_EQUAL(2u, v[1].size());
+    BOOST_CHECK_EQUAL(ValT(10), *v[1].get(KeyT(1)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_order_stats, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    judypp::Map<KeyT, ValT> js;
+    BOOST_CHECK_EQUAL(0u, js.rank(KeyT(10)));
+    BOOST_CHECK(js.select(0) == js.end());
+
+    js.put(KeyT(10)) = ValT(1);
+    js.put(KeyT(20)) = ValT(2);
+    js.put(KeyT(30)) = ValT(3);
+
+    BOOST_CHECK_EQUAL(0u, js.rank(KeyT(5)));
+    BOOST_CHECK_EQUAL(1u, js.rank(KeyT(10)));
+    BOOST_CHECK_EQUAL(2u, js.rank(KeyT(25)));
+
+    BOOST_REQUIRE(js.select(1) != js.end());
+    BOOST_CHECK_EQUAL(KeyT(20), js.select(1)->first);
+    BOOST_CHECK_EQUAL(ValT(2), js.select(1)->second);
+    BOOST_CHECK(js.select(2) == js.find(KeyT(30)));
+    BOOST_CHECK(js.select(3) == js.end());
+
+    BOOST_CHECK_EQUAL(2u, js.count(KeyT(15), KeyT(30)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_get_many, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    judypp::Map<KeyT, ValT> js;
+    js.put(KeyT(1)) = ValT(1);
+    js.put(KeyT(10)) = ValT(2);
+    js.put(KeyT(12)) = ValT(0);
+    js.put(KeyT(100)) = ValT(3);
+
+    std::vector<KeyT> keys = {KeyT(0), KeyT(1), KeyT(5), KeyT(10), KeyT(11), KeyT(12), KeyT(100), KeyT(101), KeyT(1)};
+    ValT* out[9];
+    BOOST_CHECK_EQUAL(5u, js.get_many(keys.data(), keys.size(), out));
+    for (size_t i = 0; i < keys.size(); ++i)
+        BOOST_CHECK_EQUAL(js.get(keys[i]), out[i]);
+
+    const judypp::Map<KeyT, ValT>& cjs = js;
+    const ValT* cout[9];
+    std::reverse(keys.begin(), keys.end());
+    BOOST_CHECK_EQUAL(5u, cjs.get_many(keys.data(), keys.size(), cout));
+    for (size_t i = 0; i < keys.size(); ++i)
+        BOOST_CHECK_EQUAL(cjs.get(keys[i]), cout[i]);
+
+    js.clear();
+    BOOST_CHECK_EQUAL(0u, js.get_many(keys.data(), keys.size(), out));
+    BOOST_CHECK_EQUAL(np, out[0]);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_erase_range, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    judypp::Map<KeyT, ValT> js;
+    BOOST_CHECK_EQUAL(0u, js.erase_range(KeyT(0), KeyT(100)));
+    for (long i = 1; i <= 100; ++i)
+        js.put(KeyT(i)) = ValT(i);
+
+    BOOST_CHECK_EQUAL(2u, js.erase_range(KeyT(1), KeyT(2)));
+    BOOST_CHECK_EQUAL(98u, js.size());
+    BOOST_CHECK_EQUAL(KeyT(3), js.begin()->first);
+
+    BOOST_CHECK_EQUAL(90u, js.erase_range(KeyT(4), KeyT(93)));
+    BOOST_CHECK_EQUAL(8u, js.size());
+    BOOST_CHECK_EQUAL(ValT(3), *js.get(KeyT(3)));
+    BOOST_CHECK_EQUAL(ValT(94), *js.get(KeyT(94)));
+    BOOST_CHECK(np == js.get(KeyT(50)));
+    BOOST_CHECK_EQUAL(KeyT(100), (--js.end())->first);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_for_each, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    judypp::Map<KeyT, ValT> js;
+    for (long i = 1; i <= 50; ++i)
+        js.put(KeyT(i * 2)) = ValT(i);
+
+    std::vector<KeyT> keys;
+    js.for_each([&] (KeyT k, ValT& v) { keys.push_back(k); v = ValT(1); });
+    BOOST_CHECK_EQUAL(50u, keys.size());
+    BOOST_CHECK_EQUAL(KeyT(2), keys.front());
+    BOOST_CHECK_EQUAL(KeyT(100), keys.back());
+    BOOST_CHECK_EQUAL(ValT(1), *js.get(KeyT(100)));
+
+    keys.clear();
+    const judypp::Map<KeyT, ValT>& cjs = js;
+    cjs.for_each_range(KeyT(3), KeyT(10), [&] (KeyT k, const ValT&) { keys.push_back(k); });
+    BOOST_CHECK((std::vector<KeyT>{KeyT(4), KeyT(6), KeyT(8), KeyT(10)}) == keys);
+
+    keys.clear();
+    cjs.for_each_range(KeyT(101), KeyT(120), [&] (KeyT k, const ValT&) { keys.push_back(k); });
+    cjs.for_each_range(KeyT(10), KeyT(3), [&] (KeyT k, const ValT&) { keys.push_back(k); });
+    BOOST_CHECK(keys.empty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_map_copy_entries, TPair, map_types_t)
+{
+    typedef typename TPair::KeyT KeyT;
+    typedef typename TPair::ValT ValT;
+    judypp::Map<KeyT, ValT> js;
+    for (long i = 1; i <= 40; ++i)
+        js.put(KeyT(i * 3)) = ValT(i);
+
+    KeyT lo = KeyT(10);
+    KeyT keys[8];
+    ValT values[8];
+    std::pair<size_t, bool> r = js.copy_entries(lo, keys, values, 8);
+    BOOST_CHECK_EQUAL(8u, r.first);
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_CHECK_EQUAL(KeyT(12), keys[0]);
+    BOOST_CHECK_EQUAL(ValT(4), values[0]);
+    BOOST_CHECK_EQUAL(KeyT(33), keys[7]);
+    BOOST_CHECK_EQUAL(KeyT(36), lo);
+
+    size_t total = r.first;
+    while (r.second)
+    {
+        r = js.copy_keys(lo, keys, 8);
+        total += r.first;
+    }
+    BOOST_CHECK_EQUAL(37u, total);
+    BOOST_CHECK_EQUAL(KeyT(120), keys[r.first - 1]);
+}
+
+BOOST_AUTO_TEST_CASE(test_map_signed_order)
+{
+    judypp::Map<long, int> js;
+    js.put(5) = 1;
+    js.put(-5) = 2;
+    js.put(0) = 3;
+    js.put(-1000) = 4;
+
+    std::vector<long> keys;
+    for (auto x : js)
+        keys.push_back(x.first);
+    BOOST_CHECK((std::vector<long>{-1000, -5, 0, 5}) == keys);
+    BOOST_CHECK_EQUAL(-5, js.lower_bound(-10)->first);
+    BOOST_CHECK_EQUAL(0, js.upper_bound(-5)->first);
+    BOOST_CHECK_EQUAL(5, (--js.end())->first);
+    BOOST_CHECK_EQUAL(2, js.find(-5)->second);
+    BOOST_CHECK_EQUAL(3u, js.count(-1000, 0));
+}
+
+
+namespace
+{
+    // counts live objects to check that the map constructs and destroys values
+    struct tracked
+    {
+        static int alive;
+        long a, b, c;
+
+        tracked(long x = 0) : a(x), b(x), c(x) { ++alive; }
+        tracked(const tracked& r) : a(r.a), b(r.b), c(r.c) { ++alive; }
+        ~tracked() { --alive; }
+        tracked& operator= (const tracked&) = default;
+    };
+    int tracked::alive = 0;
+
+    struct small_pod
+    {
+        short x, y;
+    };
+}
+
+BOOST_AUTO_TEST_CASE(test_map_values)
+{
+    {
+        judypp::Map<int, tracked> js;
+        js.put(1).a = 10;
+        BOOST_CHECK_EQUAL(1, tracked::alive);
+        BOOST_CHECK_EQUAL(10, js.get(1)->a);
+        BOOST_CHECK_EQUAL(true, js.try_emplace(2, 20).second);
+        BOOST_CHECK_EQUAL(false, js.try_emplace(2, 30).second);
+        BOOST_CHECK_EQUAL(20, js.find(2)->second.c);
+        BOOST_CHECK_EQUAL(false, js.insert_or_assign(2, tracked(40)).second);
+        BOOST_CHECK_EQUAL(40, js[2].b);
+        BOOST_CHECK_EQUAL(2, tracked::alive);
+
+        // values are not moved by insertions
+        tracked* p = js.get(2);
+        for (int i = 3; i < 1000; ++i)
+            js.put(i);
+        BOOST_CHECK_EQUAL(p, js.get(2));
+        BOOST_CHECK_EQUAL(999, tracked::alive);
+
+        BOOST_CHECK_EQUAL(true, js.del(500));
+        BOOST_CHECK_EQUAL(false, js.del(500));
+        BOOST_CHECK_EQUAL(998, tracked::alive);
+        BOOST_CHECK_LT(998 * sizeof(tracked), js.memory_usage());
+
+        judypp::Map<int, tracked> copy(js);
+        BOOST_CHECK_EQUAL(2 * 998, tracked::alive);
+        BOOST_CHECK_EQUAL(40, copy.get(2)->a);
+        BOOST_CHECK_NE(p, copy.get(2));
+        copy.clear();
+        BOOST_CHECK_EQUAL(998, tracked::alive);
+
+        std::vector<std::pair<int, tracked> > in{{5, 5}, {3, 3}, {5, 6}};
+        copy.insert(in.begin(), in.end());
+        BOOST_CHECK_EQUAL(2u, copy.size());
+        BOOST_CHECK_EQUAL(5, copy.get(5)->a);
+        BOOST_CHECK_EQUAL(998 + 3 + 2, tracked::alive);
+
+        js = std::move(copy);
+        BOOST_CHECK_EQUAL(2u, js.size());
+        BOOST_CHECK_EQUAL(3 + 2, tracked::alive);
+    }
+    BOOST_CHECK_EQUAL(0, tracked::alive);
+
+    {
+        judypp::Map<int, tracked> js;
+        for (int i = 0; i < 100; ++i)
+            js.put(i).a = i;
+        BOOST_CHECK_EQUAL(10u, js.erase_range(0, 9));
+        BOOST_CHECK_EQUAL(80u, js.erase_range(20, 99));
+        BOOST_CHECK_EQUAL(10, tracked::alive);
+        BOOST_CHECK_EQUAL(15, js.get(15)->a);
+    }
+    BOOST_CHECK_EQUAL(0, tracked::alive);
+
+    // movable only and strings
+    judypp::Map<long, std::unique_ptr<int> > ju;
+    ju.try_emplace(1, new int(1));
+    ju[2].reset(new int(2));
+    BOOST_CHECK_EQUAL(2, *ju.find(2)->second);
+
+    judypp::Map<long, std::string> js;
+    js[-1] = std::string(100, 'x');
+    js.insert(std::make_pair(1, "one"));
+    std::vector<std::string> values;
+    for (auto x : js)
+        values.push_back(x.second);
+    BOOST_CHECK((std::vector<std::string>{std::string(100, 'x'), "one"}) == values);
+
+    // small trivially copyable values are kept in the slots
+    judypp::Map<int, small_pod> jp;
+    jp[1] = small_pod{1, 2};
+    BOOST_CHECK_EQUAL(2, jp.get(1)->y);
+    BOOST_CHECK(judypp::value_storage<small_pod>::inplace);
+    BOOST_CHECK(!judypp::value_storage<tracked>::inplace);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,272 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+// judy_test builds this file without the hooks, judy_hooks_test with JUDYPP_DEFINE_MALLOC_HOOKS
+#include <judypp/memory.hpp>
+#include <judypp/map.hpp>
+#include <judypp/set.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+#ifdef JUDYPP_DEFINE_MALLOC_HOOKS
+
+BOOST_AUTO_TEST_CASE(test_memory_usage)
+{
+    judypp::Set<unsigned long> js;
+    judypp::Map<unsigned long, unsigned long> jm;
+    BOOST_CHECK_EQUAL(0u, js.memory_usage());
+    BOOST_CHECK_EQUAL(0u, jm.memory_usage());
+
+    const size_t before = judypp::allocated_bytes();
+    for (unsigned long i = 0; i < 10000; ++i)
+    {
+        js.set(i * 7);
+        jm.put(i * 7) = i;
+    }
+    BOOST_CHECK_LT(0u, js.memory_usage());
+    BOOST_CHECK_LT(0u, jm.memory_usage());
+    BOOST_CHECK_LT(before, judypp::allocated_bytes());
+
+    js.clear();
+    jm.clear();
+    BOOST_CHECK_EQUAL(0u, js.memory_usage());
+    BOOST_CHECK_EQUAL(0u, jm.memory_usage());
+    BOOST_CHECK_EQUAL(before, judypp::allocated_bytes());
+}
+
+BOOST_AUTO_TEST_CASE(test_clear_deferred)
+{
+    judypp::Set<unsigned long> js;
+    judypp::Map<unsigned long, std::string> jm;
+    const size_t before = judypp::allocated_bytes();
+    for (unsigned long i = 0; i < 10000; ++i)
+    {
+        js.set(i * 7);
+        jm.put(i * 7) = std::string(50, 'x');
+    }
+
+    // containers are empty and usable at once, memory is returned in background
+    js.clear_deferred();
+    jm.clear_deferred();
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK_EQUAL(true, jm.empty());
+    BOOST_CHECK_EQUAL(false, js.test(7));
+    js.set(1);
+    jm.put(1) = "a";
+    BOOST_CHECK_EQUAL("a", *jm.get(1));
+
+    js.clear();
+    jm.clear();
+    judypp::Reclaimer::instance().drain();
+    BOOST_CHECK_EQUAL(before, judypp::allocated_bytes());
+
+    // arena is released in place
+    {
+        judypp::Set<unsigned long, judypp::arena_alloc> ja;
+        ja.set(1);
+        ja.clear_deferred();
+        BOOST_CHECK_EQUAL(true, ja.empty());
+    }
+    BOOST_CHECK_EQUAL(before, judypp::allocated_bytes());
+}
+
+BOOST_AUTO_TEST_CASE(test_arena_alloc)
+{
+    BOOST_REQUIRE(judypp::malloc_hooks_enabled());
+    const size_t before = judypp::allocated_bytes();
+    {
+        judypp::Set<unsigned long, judypp::arena_alloc> js;
+        judypp::Map<unsigned long, unsigned long, judypp::arena_alloc> jm;
+        for (unsigned long i = 0; i < 10000; ++i)
+        {
+            js.set(i * 7);
+            jm.put(i * 7) = i;
+        }
+        for (unsigned long i = 0; i < 10000; i += 2)
+        {
+            js.unset(i * 7);
+            jm.del(i * 7);
+        }
+        BOOST_CHECK_EQUAL(5000u, js.size());
+        BOOST_CHECK_EQUAL(5000u, jm.size());
+        BOOST_CHECK_EQUAL(true, js.test(7));
+        BOOST_CHECK_EQUAL(false, js.test(14));
+        BOOST_CHECK_EQUAL(1u, *jm.get(7));
+        BOOST_CHECK_LT(before, judypp::allocated_bytes());
+
+        // copy and move keep each container in its own arena
+        auto js_copy(js);
+        auto jm_copy(jm);
+        js.clear();
+        jm.clear();
+        BOOST_CHECK_EQUAL(5000u, js_copy.size());
+        BOOST_CHECK_EQUAL(true, js_copy.test(7));
+        BOOST_CHECK_EQUAL(1u, *jm_copy.get(7));
+
+        decltype(jm) jm_moved(std::move(jm_copy));
+        jm_moved.put(2) = 3;
+        BOOST_CHECK_EQUAL(5001u, jm_moved.size());
+        BOOST_CHECK_EQUAL(1u, *jm_moved.get(7));
+
+        // heap containers are not affected by arenas
+        judypp::Set<unsigned long> heap;
+        heap.set(1);
+        js.set(1);
+        heap.set(2);
+        BOOST_CHECK_EQUAL(2u, heap.size());
+    }
+    BOOST_CHECK_EQUAL(before, judypp::allocated_bytes());
+}
+
+BOOST_AUTO_TEST_CASE(test_arena_nested_values)
+{
+    BOOST_REQUIRE(judypp::malloc_hooks_enabled());
+    const size_t before = judypp::allocated_bytes();
+    {
+        // heap sets in the arena map are freed to the heap, not to the arena
+        judypp::Map<int, judypp::Set<int>, judypp::arena_alloc> jm;
+        for (int k = 1; k <= 4; ++k)
+            for (int i = 0; i < 1000; ++i)
+                jm.put(k).set(i * 7);
+        BOOST_CHECK_EQUAL(true, jm.del(1));
+        BOOST_CHECK_EQUAL(1u, jm.erase_range(2, 2));
+        BOOST_CHECK_EQUAL(2u, jm.size());
+        BOOST_CHECK_EQUAL(1000u, jm.get(3)->size());
+    }
+    BOOST_CHECK_EQUAL(before, judypp::allocated_bytes());
+}
+
+BOOST_AUTO_TEST_CASE(test_value_pool_counted)
+{
+    BOOST_REQUIRE(judypp::malloc_hooks_enabled());
+    struct big_value { char data[8192]; };
+    const size_t before = judypp::allocated_bytes();
+    {
+        // values out of the slots are counted and limited like Judy nodes
+        judypp::Map<unsigned long, std::string> jm;
+        for (unsigned long i = 0; i < 1000; ++i)
+            jm.put(i) = "x";
+        BOOST_CHECK_LE(before + 1000 * sizeof(std::string), judypp::allocated_bytes());
+
+        // Judy nodes of the key fit into the limit, the chunk of values does not
+        judypp::Map<unsigned long, big_value> big;
+        judypp::set_memory_limit(judypp::allocated_bytes() + sizeof(big_value));
+        BOOST_CHECK_THROW(big.put(1), std::bad_alloc);
+        BOOST_CHECK_EQUAL(true, big.empty());
+        judypp::set_memory_limit(size_t(-1));
+        big.put(1).data[0] = 'y';
+        BOOST_CHECK_EQUAL('y', big.get(1)->data[0]);
+    }
+    BOOST_CHECK_EQUAL(before, judypp::allocated_bytes());
+}
+
+BOOST_AUTO_TEST_CASE(test_checked_alloc)
+{
+    BOOST_REQUIRE(judypp::malloc_hooks_enabled());
+    typedef judypp::checked<judypp::heap_alloc> checked_heap;
+    typedef judypp::checked<judypp::arena_alloc> checked_arena;
+
+    judypp::Set<unsigned long, checked_heap> js;
+    judypp::Set<unsigned long, checked_arena> ja;
+    judypp::Map<unsigned long, std::string, checked_heap> jm;
+    for (unsigned long i = 0; i < 100; ++i)
+    {
+        js.set(i);
+        ja.set(i);
+        jm.put(i) = "x";
+    }
+
+    // out of memory in Judy throws and leaves containers consistent
+    judypp::set_memory_limit(judypp::allocated_bytes());
+    unsigned long k = 100;
+    BOOST_CHECK_THROW(for (; k < 1000000; ++k) js.set(k), std::bad_alloc);
+    BOOST_CHECK_EQUAL(k, js.size());
+    BOOST_CHECK_EQUAL(false, js.test(k));
+
+    unsigned long a = 100;
+    BOOST_CHECK_THROW(for (; a < 1000000; ++a) ja.set(a), std::bad_alloc);
+    BOOST_CHECK_EQUAL(a, ja.size());
+
+    unsigned long m = 100;
+    BOOST_CHECK_THROW(for (; m < 1000000; ++m) jm.put(m) = "y", std::bad_alloc);
+    BOOST_CHECK_EQUAL(m, jm.size());
+    BOOST_CHECK(NULL == jm.get(m));
+    BOOST_CHECK_EQUAL("x", *jm.get(1));
+
+    std::vector<unsigned long> keys(100000);
+    for (size_t i = 0; i < keys.size(); ++i)
+        keys[i] = i;
+    judypp::Set<unsigned long, checked_heap> jb;
+    BOOST_CHECK_THROW(jb.insert(keys.begin(), keys.end()), std::bad_alloc);
+    BOOST_CHECK_EQUAL(true, jb.empty());
+
+    judypp::set_memory_limit(size_t(-1));
+    BOOST_CHECK_EQUAL(true, js.set(k));
+    BOOST_CHECK_EQUAL(true, ja.set(a));
+    jm.put(m) = "z";
+    BOOST_CHECK_EQUAL(m + 1, jm.size());
+    jb.insert(keys.begin(), keys.end());
+    BOOST_CHECK_EQUAL(keys.size(), jb.size());
+}
+
+#else
+
+BOOST_AUTO_TEST_CASE(test_default_alloc)
+{
+    BOOST_CHECK_EQUAL(false, judypp::malloc_hooks_enabled());
+    BOOST_CHECK_EQUAL(false, judypp::arena_alloc().release());
+
+    // nothing is counted or limited without the hooks, arenas fall back to the heap
+    judypp::set_memory_limit(0);
+    {
+        judypp::Set<unsigned long, judypp::arena_alloc> ja;
+        judypp::Map<unsigned long, std::string> jm;
+        judypp::Map<unsigned long, unsigned long, judypp::checked<judypp::heap_alloc> > jc;
+        for (unsigned long i = 0; i < 10000; ++i)
+        {
+            ja.set(i * 7);
+            jm.put(i * 7) = "x";
+            jc.put(i * 7) = i;
+        }
+        BOOST_CHECK_EQUAL(10000u, ja.size());
+        BOOST_CHECK_EQUAL(10000u, jm.size());
+        BOOST_CHECK_EQUAL(10000u, jc.size());
+        BOOST_CHECK_LT(0u, jm.memory_usage());
+        BOOST_CHECK_EQUAL(0u, judypp::allocated_bytes());
+
+        ja.clear_deferred();
+        jm.clear_deferred();
+        BOOST_CHECK_EQUAL(true, ja.empty());
+        BOOST_CHECK_EQUAL(true, jm.empty());
+        judypp::Reclaimer::instance().drain();
+    }
+    BOOST_CHECK_EQUAL(0u, judypp::allocated_bytes());
+    judypp::set_memory_limit(size_t(-1));
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
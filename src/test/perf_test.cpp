@@ -26,13 +26,35 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <chrono>
 #include <stdio.h>
 #include <iostream>
+#include <sstream>
 #include <string.h>
+#ifdef HAVE_MALLINFO2
+#   include <malloc.h>
+#endif
 
+// perf_test_hooks is built with the counting malloc hooks of Judy, perf_test without them
+#ifdef PERF_MALLOC_HOOKS
+#   define JUDYPP_DEFINE_MALLOC_HOOKS
+#endif
+#include <judypp/concurrent.hpp>
+#include <judypp/frozen.hpp>
+#include <judypp/hybrid_set.hpp>
+#include <judypp/map.hpp>
+#include <judypp/memory.hpp>
 #include <judypp/set.hpp>
+#include <judypp/sharded.hpp>
+#include <judypp/string_map.hpp>
+#include <mutex>
+#include <random>
 #include <set>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #ifdef HAVE_GOOGLE_SPARSE_HASH
@@ -48,6 +70,27 @@ std::chrono::microseconds benchmark(F f)
     return std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
 }
 
+// bytes in use by malloc, 0 if it is unknown
+size_t heap_used()
+{
+#ifdef HAVE_MALLINFO2
+    const struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+template <typename T>
+std::string bytes_per_key(size_t before, size_t after, T count)
+{
+    if (0 == after)
+        return std::string();
+    std::ostringstream os;
+    os << ", " << ((double)after - (double)before) / count << " bytes per key";
+    return os.str();
+}
+
 // Abstract set interface
 // template <typename T>
 // struct Set
@@ -94,6 +137,18 @@ public:
     }
 };
 
+template <typename T>
+using JudySet = judypp::Set<T>;
+
+template <typename T>
+using JudyArenaSet = judypp::Set<T, judypp::arena_alloc>;
+
+template <typename T>
+using JudyHybridSet = judypp::HybridSet<T>;
+
+template <typename T>
+using JudyCheckedSet = judypp::Set<T, judypp::checked<judypp::heap_alloc> >;
+
 template <typename T>
 class StdSet
 {
@@ -143,6 +198,7 @@ volatile bool b;
 template <template <typename T> class Cont, typename T>
 void test_LimitedNumbers(const char* name, T count, T start, T step)
 {
+    size_t heap = heap_used();
     Cont<T> t;
     std::cout << name << " " << count << " filled in " << benchmark([&] ()
             {
@@ -151,7 +207,7 @@ void test_LimitedNumbers(const char* name, T count, T start, T step)
                     t.insert(start);
                     start += step;
                 }
-            }).count() << " mcs\n";
+            }).count() << " mcs" << bytes_per_key(heap, heap_used(), count) << "\n";
 
     std::cout << name << " " << count << " all numbers checked in " << benchmark([&] ()
             {
@@ -161,10 +217,11 @@ void test_LimitedNumbers(const char* name, T count, T start, T step)
 
     Cont<T>* p = nullptr;
 
+    heap = heap_used();
     std::cout << name << " " << count << " copied in " << benchmark([&] ()
             {
                 p = new Cont<T>(t);
-            }).count() << " mcs\n";
+            }).count() << " mcs" << bytes_per_key(heap, heap_used(), count) << "\n";
 
     std::cout << name << " " << count << " destroyed in " << benchmark([&] ()
             {
@@ -179,7 +236,16 @@ void test_allLimitedNumers(const char* type, T count, T start, T step)
     std::cout <<"\n";
     test_LimitedNumbers<BitSet, T>("bitset", count, start, step);
     std::cout <<"\n";
-    test_LimitedNumbers<judypp::Set, T>("judypp::set", count, start, step);
+    test_LimitedNumbers<JudySet, T>("judypp::set", count, start, step);
+    std::cout <<"\n";
+#ifdef PERF_MALLOC_HOOKS
+    // arenas are used through the hooks only
+    test_LimitedNumbers<JudyArenaSet, T>("judypp::set<arena_alloc>", count, start, step);
+    std::cout <<"\n";
+#endif
+    test_LimitedNumbers<JudyCheckedSet, T>("judypp::set<checked<heap_alloc>>", count, start, step);
+    std::cout <<"\n";
+    test_LimitedNumbers<JudyHybridSet, T>("judypp::HybridSet", count, start, step);
     std::cout <<"\n";
     test_LimitedNumbers<StdSet, T>("std::set", count, start, step);
     std::cout <<"\n";
@@ -193,8 +259,540 @@ void test_allLimitedNumers(const char* type, T count, T start, T step)
     std::cout <<"\n";
 }
 
+// Loading of sorted keys, the common case of rebuilding from an ordered source
+template <typename T>
+void test_SortedLoad(const char* type, T count)
+{
+    std::cout << "\n===== sorted load " << type << "(" << count << ") =====\n";
+    std::cout <<"\n";
+
+    std::vector<T> keys(count);
+    for (T i = 0; i < count; ++i)
+        keys[i] = 10 + 3 * i;
+
+    judypp::Set<T> one, bulk;
+    std::cout << "judypp::set " << count << " filled one by one in " << benchmark([&] ()
+            {
+                for (T k : keys)
+                    one.set(k);
+            }).count() << " mcs\n";
+
+    std::cout << "judypp::set " << count << " filled by assign_sorted in " << benchmark([&] ()
+            {
+                bulk.assign_sorted(keys.begin(), keys.end());
+            }).count() << " mcs\n";
+
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    judypp::Set<T> par;
+    std::cout << "judypp::set " << count << " filled by build_parallel on " << threads << " threads in " << benchmark([&] ()
+            {
+                par.build_parallel(keys.begin(), keys.end(), threads);
+            }).count() << " mcs\n";
+
+    judypp::ShardedSet<T, 64> sharded;
+    std::cout << "judypp::ShardedSet<64> " << count << " filled by build_parallel on " << threads << " threads in " << benchmark([&] ()
+            {
+                sharded.build_parallel(keys.begin(), keys.end(), threads);
+            }).count() << " mcs\n";
+
+    std::stringstream saved;
+    std::cout << "judypp::set " << count << " saved in " << benchmark([&] ()
+            {
+                one.save(saved);
+            }).count() << " mcs, " << (double)saved.str().size() / count << " bytes per key\n";
+    judypp::Set<T> loaded;
+    std::cout << "judypp::set " << count << " loaded in " << benchmark([&] ()
+            {
+                loaded.load(saved);
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << count << " lower half erased by erase_range in " << benchmark([&] ()
+            {
+                loaded.erase_range(keys.front(), keys[count / 2]);
+            }).count() << " mcs\n";
+
+    std::cout << "judypp::set " << count << " cleared in " << benchmark([&] ()
+            {
+                one.clear();
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << count << " cleared by clear_deferred in " << benchmark([&] ()
+            {
+                bulk.clear_deferred();
+            }).count() << " mcs\n";
+    std::cout << "judypp::ShardedSet<64> " << count << " cleared by clear_parallel in " << benchmark([&] ()
+            {
+                sharded.clear_parallel(threads);
+            }).count() << " mcs\n";
+    judypp::Reclaimer::instance().drain();
+    std::cout <<"\n";
+}
+
+// String keys: put into the map and get all of them back
+template <typename Map>
+void test_StringKeys(const char* name, const std::vector<std::string>& keys)
+{
+    size_t heap = heap_used();
+    Map m;
+    std::cout << name << " " << keys.size() << " filled in " << benchmark([&] ()
+            {
+                long i = 0;
+                for (const auto& k : keys)
+                    m[k] = ++i;
+            }).count() << " mcs" << bytes_per_key(heap, heap_used(), keys.size()) << "\n";
+
+    std::cout << name << " " << keys.size() << " all keys found in " << benchmark([&] ()
+            {
+                for (const auto& k : keys)
+                    b = m.end() != m.find(k);
+            }).count() << " mcs\n";
+}
+
+// JudyHS has no iteration, so find() is emulated by get()
+template <typename T>
+struct HashMapFind : judypp::HashMap<T>
+{
+    int end() const { return 0; }
+    int find(judypp::string_key k) const { return NULL != this->get(k); }
+};
+
+void test_allStringKeys(size_t count)
+{
+    std::cout << "\n===== string keys(" << count << ") =====\n";
+    std::cout <<"\n";
+
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        keys.push_back("tenant-" + std::to_string(i % 1000) + "/metric." + std::to_string(i * 2654435761u % count));
+
+    test_StringKeys<judypp::StringMap<long> >("judypp::StringMap", keys);
+    std::cout <<"\n";
+    test_StringKeys<HashMapFind<long> >("judypp::HashMap", keys);
+    std::cout <<"\n";
+    test_StringKeys<std::unordered_map<std::string, long> >("std::unordered_map<std::string>", keys);
+    std::cout <<"\n";
+}
+
+// Values of Size bytes, they are kept in the pool of judypp::Map
+template <size_t Size>
+struct Payload
+{
+    char data[Size];
+
+    Payload(int64_t v = 0) { memset(data, (int)v, Size); }
+};
+
+template <typename Map>
+void test_Values(const char* name, int64_t count)
+{
+    typedef typename Map::mapped_type value_t;
+
+    size_t heap = heap_used();
+    Map m;
+    std::cout << name << " " << count << " filled in " << benchmark([&] ()
+            {
+                for (int64_t i = 0; i < count; ++i)
+                    m.emplace(std::piecewise_construct, std::forward_as_tuple(i * 7), std::forward_as_tuple(i));
+            }).count() << " mcs" << bytes_per_key(heap, heap_used(), count) << "\n";
+
+    std::cout << name << " " << count << " all keys found in " << benchmark([&] ()
+            {
+                for (int64_t i = 0; i < count; ++i)
+                    b = m.find(i * 7)->second.data[0] == (char)i;
+            }).count() << " mcs\n";
+
+    std::cout << name << " " << count << " iterated in " << benchmark([&] ()
+            {
+                for (const auto& x : m)
+                    b = x.second.data[sizeof(value_t) - 1];
+            }).count() << " mcs\n";
+}
+
+// std::map::emplace with piecewise construction is taken by try_emplace
+template <typename Key, typename T, typename Alloc = judypp::heap_alloc>
+struct JudyMapEmplace : judypp::Map<Key, T, Alloc>
+{
+    template <typename K, typename V>
+    void emplace(std::piecewise_construct_t, K k, V v) { this->try_emplace(std::get<0>(k), std::get<0>(v)); }
+};
+
+template <size_t Size>
+void test_allValues(int64_t count)
+{
+    std::cout << "\n===== values of " << Size << " bytes(" << count << ") =====\n";
+    std::cout <<"\n";
+    test_Values<JudyMapEmplace<int64_t, Payload<Size> > >("judypp::Map", count);
+    std::cout <<"\n";
+    test_Values<JudyMapEmplace<int64_t, Payload<Size>, judypp::checked<judypp::heap_alloc> > >("judypp::Map<checked<heap_alloc>>", count);
+    std::cout <<"\n";
+    test_Values<std::unordered_map<int64_t, Payload<Size> > >("std::unordered_map", count);
+    std::cout <<"\n";
+}
+
+// Lookups of batches of keys: the scalar loop of get() against get_many()
+void test_BatchLookup(const char* order, uint64_t count, size_t batch, bool sorted)
+{
+    judypp::Map<uint64_t, void*> m;
+    for (uint64_t i = 0; i < count; ++i)
+        m.put(i * 3) = &m;
+
+    // a half of the keys is absent
+    std::vector<uint64_t> keys(count);
+    for (uint64_t i = 0; i < count; ++i)
+        keys[i] = (i * 2654435761u) % (3 * count / 2) * 2;
+    if (sorted)
+        for (size_t i = 0; i < keys.size(); i += batch)
+            std::sort(keys.begin() + i, keys.begin() + std::min(i + batch, keys.size()));
+
+    std::vector<void**> out(batch);
+    auto report = [&] (const char* name, std::chrono::microseconds t)
+    {
+        std::cout << "judypp::Map " << name << " " << count << " " << order << " keys by " << batch << " in "
+                  << t.count() << " mcs, " << count / std::max<double>(1, t.count()) << " Mkeys/s\n";
+    };
+
+    report("get", benchmark([&] ()
+            {
+                for (size_t i = 0; i < keys.size(); i += batch)
+                    for (size_t j = i; j < std::min(i + batch, keys.size()); ++j)
+                        out[j - i] = m.get(keys[j]);
+                b = NULL != out[0];
+            }));
+
+    report("get_many", benchmark([&] ()
+            {
+                for (size_t i = 0; i < keys.size(); i += batch)
+                    m.get_many(&keys[i], std::min(batch, keys.size() - i), out.data());
+                b = NULL != out[0];
+            }));
+}
+
+void test_allBatchLookup(uint64_t count)
+{
+    std::cout << "\n===== batch lookup(" << count << ") =====\n";
+    std::cout <<"\n";
+    test_BatchLookup("random", count, 4096, false);
+    test_BatchLookup("sorted", count, 4096, true);
+    test_BatchLookup("sorted", count, 64, true);
+    std::cout <<"\n";
+}
+
+// Full scans: iterators against for_each and copying by chunks, dense keys go by runs of consecutive ones
+void test_Scan(const char* name, uint64_t count, uint64_t step)
+{
+    judypp::Set<uint64_t> js;
+    judypp::Map<uint64_t, uint64_t> jm;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        js.set(i * step);
+        jm.put(i * step) = i;
+    }
+
+    uint64_t sum = 0;
+    std::cout << "judypp::set " << name << " " << count << " iterated in " << benchmark([&] ()
+            {
+                for (uint64_t k : js)
+                    sum += k;
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << name << " " << count << " for_each in " << benchmark([&] ()
+            {
+                js.for_each([&] (uint64_t k) { sum += k; });
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << name << " " << count << " copy_keys by 4096 in " << benchmark([&] ()
+            {
+                std::vector<uint64_t> buf(4096);
+                uint64_t lo = 0;
+                std::pair<size_t, bool> r;
+                do
+                {
+                    r = js.copy_keys(lo, buf.data(), buf.size());
+                    for (size_t i = 0; i < r.first; ++i)
+                        sum += buf[i];
+                }
+                while (r.second);
+            }).count() << " mcs\n";
+    std::cout << "judypp::Map " << name << " " << count << " iterated in " << benchmark([&] ()
+            {
+                for (const auto& x : jm)
+                    sum += x.second;
+            }).count() << " mcs\n";
+    std::cout << "judypp::Map " << name << " " << count << " for_each in " << benchmark([&] ()
+            {
+                jm.for_each([&] (uint64_t, uint64_t v) { sum += v; });
+            }).count() << " mcs\n";
+    std::cout << "judypp::Map " << name << " " << count << " copy_entries by 4096 in " << benchmark([&] ()
+            {
+                std::vector<uint64_t> keys(4096), values(4096);
+                uint64_t lo = 0;
+                std::pair<size_t, bool> r;
+                do
+                {
+                    r = jm.copy_entries(lo, keys.data(), values.data(), keys.size());
+                    for (size_t i = 0; i < r.first; ++i)
+                        sum += values[i];
+                }
+                while (r.second);
+            }).count() << " mcs\n";
+    b = sum & 1;
+}
+
+void test_allScan(uint64_t count)
+{
+    std::cout << "\n===== scan(" << count << ") =====\n";
+    std::cout <<"\n";
+    test_Scan("dense", count, 1);
+    test_Scan("sparse", count, 7);
+    std::cout <<"\n";
+}
+
+// Dense ids moved between judypp::set and packed bitmaps by words against loops by bits
+void test_Bitmap(uint64_t range)
+{
+    std::cout << "\n===== bitmap(" << range << ") =====\n";
+    std::cout <<"\n";
+
+    judypp::Set<uint64_t> js;
+    for (uint64_t i = 0; i < range; ++i)
+        if (i % 4 != 3)
+            js.set(i);
+
+    std::vector<uint64_t> words((range + 63) / 64);
+    std::cout << "judypp::set " << range << " exported by test() in " << benchmark([&] ()
+            {
+                std::fill(words.begin(), words.end(), uint64_t(0));
+                for (uint64_t i = 0; i < range; ++i)
+                    if (js.test(i))
+                        words[i / 64] |= uint64_t(1) << (i % 64);
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << range << " exported by to_bitmap in " << benchmark([&] ()
+            {
+                js.to_bitmap(0, range - 1, words.data());
+            }).count() << " mcs\n";
+
+    judypp::Set<uint64_t> bits, bulk, more;
+    more.set(range);
+    std::cout << "judypp::set " << range << " imported by set() in " << benchmark([&] ()
+            {
+                for (uint64_t i = 0; i < range; ++i)
+                    if (words[i / 64] >> (i % 64) & 1)
+                        bits.set(i);
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << range << " imported by from_bitmap into the empty set in " << benchmark([&] ()
+            {
+                bulk.from_bitmap(0, words.data(), words.size());
+            }).count() << " mcs\n";
+    std::cout << "judypp::set " << range << " imported by from_bitmap into the filled set in " << benchmark([&] ()
+            {
+                more.from_bitmap(0, words.data(), words.size());
+            }).count() << " mcs\n";
+    b = bits.size() == bulk.size();
+    std::cout <<"\n";
+}
+
+// Lookups from many reader threads while one writer publishes updates
+template <typename Table>
+void test_ConcurrentReads(const char* name, unsigned threads, uint64_t count, uint64_t lookups)
+{
+    Table table(count);
+    std::atomic<bool> stop(false);
+    std::thread writer([&] ()
+            {
+                for (uint64_t i = 0; !stop; ++i)
+                {
+                    table.update(i % count);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            });
+
+    const auto t = benchmark([&] ()
+            {
+                std::vector<std::thread> readers;
+                for (unsigned n = 0; n < threads; ++n)
+                    readers.emplace_back([&, n] ()
+                            {
+                                uint64_t k = n;
+                                for (uint64_t i = 0; i < lookups; ++i)
+                                {
+                                    b = table.find(k % count);
+                                    k += 2654435761u;
+                                }
+                            });
+                for (auto& r : readers)
+                    r.join();
+            });
+    stop = true;
+    writer.join();
+
+    std::cout << name << " " << threads << " readers, " << lookups << " lookups each in " << t.count() << " mcs, "
+              << threads * lookups / std::max<double>(1, t.count()) << " Mlookups/s\n";
+}
+
+struct ConcurrentTable
+{
+    judypp::ConcurrentMap<uint64_t, uint64_t> m_Map;
+
+    explicit ConcurrentTable(uint64_t count)
+    {
+        m_Map.publish([count] (judypp::Map<uint64_t, uint64_t>& m) { for (uint64_t i = 0; i < count; ++i) m.put(i) = i; });
+    }
+    void update(uint64_t k) { m_Map.publish([k] (judypp::Map<uint64_t, uint64_t>& m) { ++m.put(k); }); }
+    bool find(uint64_t k) const { return NULL != m_Map.read()->get(k); }
+};
+
+struct SharedMutexTable
+{
+    judypp::Map<uint64_t, uint64_t> m_Map;
+    mutable std::shared_timed_mutex m_Lock;
+
+    explicit SharedMutexTable(uint64_t count) { for (uint64_t i = 0; i < count; ++i) m_Map.put(i) = i; }
+    void update(uint64_t k)
+    {
+        std::lock_guard<std::shared_timed_mutex> lock(m_Lock);
+        ++m_Map.put(k);
+    }
+    bool find(uint64_t k) const
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(m_Lock);
+        return NULL != m_Map.get(k);
+    }
+};
+
+void test_allConcurrentReads(uint64_t count)
+{
+    std::cout << "\n===== concurrent reads(" << count << ") =====\n";
+    std::cout <<"\n";
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= cores; threads *= 2)
+    {
+        test_ConcurrentReads<ConcurrentTable>("judypp::ConcurrentMap", threads, count, 1000000);
+        test_ConcurrentReads<SharedMutexTable>("judypp::Map with shared_timed_mutex", threads, count, 1000000);
+    }
+    std::cout <<"\n";
+}
+
+// Insertion of random event ids from many threads
+uint64_t splitmix64(uint64_t& x)
+{
+    uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+template <typename Insert>
+void test_ParallelInsert(const char* name, unsigned threads, uint64_t count, Insert insert)
+{
+    const auto t = benchmark([&] ()
+            {
+                std::vector<std::thread> writers;
+                for (unsigned n = 0; n < threads; ++n)
+                    writers.emplace_back([&, n] ()
+                            {
+                                uint64_t seed = n;
+                                insert(seed, count / threads);
+                            });
+                for (auto& w : writers)
+                    w.join();
+            });
+    std::cout << name << " " << threads << " threads, " << count << " keys in " << t.count() << " mcs, "
+              << count / std::max<double>(1, t.count()) << " Minserts/s\n";
+}
+
+void test_allParallelInsert(uint64_t count)
+{
+    std::cout << "\n===== parallel insert(" << count << ") =====\n";
+    std::cout <<"\n";
+    for (unsigned threads = 1; threads <= 32; threads *= 2)
+    {
+        {
+            judypp::Set<uint64_t> set;
+            std::mutex lock;
+            test_ParallelInsert("judypp::set with mutex", threads, count, [&] (uint64_t& seed, uint64_t n)
+                    {
+                        for (uint64_t i = 0; i < n; ++i)
+                        {
+                            const uint64_t k = splitmix64(seed);
+                            std::lock_guard<std::mutex> l(lock);
+                            set.set(k);
+                        }
+                    });
+        }
+        {
+            judypp::ShardedSet<uint64_t, 64> set;
+            test_ParallelInsert("judypp::ShardedSet<64>", threads, count, [&] (uint64_t& seed, uint64_t n)
+                    {
+                        for (uint64_t i = 0; i < n; ++i)
+                            set.set(splitmix64(seed));
+                    });
+        }
+        {
+            judypp::ShardedSet<uint64_t, 64> set;
+            test_ParallelInsert("judypp::ShardedSet<64>::set_many", threads, count, [&] (uint64_t& seed, uint64_t n)
+                    {
+                        std::vector<uint64_t> batch(1024);
+                        for (uint64_t i = 0; i < n; i += batch.size())
+                        {
+                            batch.resize(std::min<uint64_t>(batch.size(), n - i));
+                            for (auto& k : batch)
+                                k = splitmix64(seed);
+                            set.set_many(batch.data(), batch.size());
+                        }
+                    });
+        }
+    }
+    std::cout <<"\n";
+}
+
+// Lookups in the mutable containers against frozen copies in the Eytzinger layout
+template <typename Frozen, typename Cont, typename Lookup>
+void test_Freeze(const char* name, const Cont& c, const std::vector<uint64_t>& probes, Lookup lookup)
+{
+    const Frozen f = c.freeze();
+    std::cout << name << " " << c.size() << " " << (double)c.memory_usage() / c.size() << " bytes per key, frozen "
+        << (double)f.memory_usage() / c.size() << " bytes per key\n";
+    std::cout << name << " " << probes.size() << " random lookups in " << benchmark([&] ()
+            {
+                for (uint64_t k : probes)
+                    b = lookup(c, k);
+            }).count() << " mcs, frozen in " << benchmark([&] ()
+            {
+                for (uint64_t k : probes)
+                    b = lookup(f, k);
+            }).count() << " mcs\n";
+}
+
+void test_allFreeze(uint64_t count)
+{
+    std::cout << "\n===== freeze(" << count << ") =====\n";
+    std::cout <<"\n";
+
+    uint64_t seed = 1;
+    judypp::Set<uint64_t> js, dense;
+    judypp::Map<uint64_t, uint64_t> jm;
+    std::vector<uint64_t> probes;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const uint64_t k = splitmix64(seed) >> 24;
+        js.set(k);
+        jm.put(k) = i;
+        dense.set(i);
+        // half of lookups hit
+        probes.push_back(i % 2 ? k : splitmix64(seed) >> 24);
+    }
+    std::shuffle(probes.begin(), probes.end(), std::mt19937_64(seed));
+
+    test_Freeze<judypp::FrozenSet<uint64_t> >("judypp::set random", js, probes,
+            [] (const auto& s, uint64_t k) { return s.test(k); });
+    test_Freeze<judypp::FrozenSet<uint64_t> >("judypp::set dense", dense, probes,
+            [] (const auto& s, uint64_t k) { return s.test(k % (2 * s.size())); });
+    test_Freeze<judypp::FrozenMap<uint64_t, uint64_t> >("judypp::Map random", jm, probes,
+            [] (const auto& m, uint64_t k) { return NULL != m.get(k); });
+    std::cout <<"\n";
+}
+
 int main()
 {
+    std::cout << "Judy malloc hooks: " << (judypp::malloc_hooks_enabled() ? "on" : "off") << "\n";
+
     test_allLimitedNumers<int64_t>("int64_t", 1000, 10, 1);
     test_allLimitedNumers<int64_t>("int64_t", 1000, 10, 3);
     test_allLimitedNumers<int64_t>("int64_t", 10000, 10, 1);
@@ -214,5 +812,29 @@ int main()
     test_allLimitedNumers<int16_t>("int16_t", 10000, 10, 1);
     test_allLimitedNumers<int16_t>("int16_t", 10000, 10, 3);
 
+    test_SortedLoad<int64_t>("int64_t", 1000000);
+    test_SortedLoad<int64_t>("int64_t", 10000000);
+
+    test_allStringKeys(100000);
+    test_allStringKeys(1000000);
+
+    test_allValues<16>(1000000);
+    test_allValues<32>(1000000);
+    test_allValues<64>(1000000);
+
+    test_allBatchLookup(1000000);
+    test_allBatchLookup(10000000);
+
+    test_allScan(10000000);
+
+    test_Bitmap(10000000);
+
+    test_allConcurrentReads(100000);
+
+    test_allParallelInsert(10000000);
+
+    test_allFreeze(1000000);
+    test_allFreeze(10000000);
+
     return 0;
 }
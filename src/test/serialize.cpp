@@ -0,0 +1,295 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#include <judypp/frozen.hpp>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace boost::unit_test;
+
+namespace
+{
+    //! takes up to the limit of bytes and fails the rest
+    class limited_buf : public std::streambuf
+    {
+        std::streamsize m_Left;
+
+    public:
+        explicit limited_buf(std::streamsize aLimit) : m_Left(aLimit) {}
+
+    protected:
+        std::streamsize xsputn(const char*, std::streamsize n) override
+        {
+            const std::streamsize r = std::min(n, m_Left);
+            m_Left -= r;
+            return r;
+        }
+
+        int_type overflow(int_type) override { return traits_type::eof(); }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+BOOST_AUTO_TEST_CASE(test_set_save_load)
+{
+    judypp::Set<long> js;
+    for (long i = -1000; i < 100000; i += 7)
+        js.set(i);
+    js.set(std::numeric_limits<long>::max());
+
+    std::stringstream ss;
+    BOOST_CHECK_EQUAL(true, js.save(ss));
+    // about a byte per key
+    BOOST_CHECK_LT(ss.str().size(), 2 * js.size());
+
+    judypp::Set<long> loaded;
+    loaded.set(1);
+    BOOST_CHECK_EQUAL(true, loaded.load(ss));
+    BOOST_CHECK_EQUAL(js.size(), loaded.size());
+    BOOST_CHECK(std::equal(js.begin(), js.end(), loaded.begin()));
+
+    // empty one
+    std::stringstream es;
+    BOOST_CHECK_EQUAL(true, judypp::Set<long>().save(es));
+    BOOST_CHECK_EQUAL(true, loaded.load(es));
+    BOOST_CHECK_EQUAL(true, loaded.empty());
+
+    // broken input does not change the set
+    loaded.set(5);
+    std::string data = ss.str();
+    std::istringstream cut(data.substr(0, data.size() / 2));
+    BOOST_CHECK_EQUAL(false, loaded.load(cut));
+    std::istringstream map_data("JUDYPPm\1");
+    BOOST_CHECK_EQUAL(false, loaded.load(map_data));
+    BOOST_CHECK_EQUAL(1u, loaded.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_map_save_load)
+{
+    judypp::Map<unsigned long, int> jm;
+    for (unsigned long i = 0; i < 10000; ++i)
+        jm.put(i * i) = -int(i);
+
+    std::stringstream ss;
+    BOOST_CHECK_EQUAL(true, jm.save(ss));
+    judypp::Map<unsigned long, int> loaded;
+    BOOST_CHECK_EQUAL(true, loaded.load(ss));
+    BOOST_CHECK_EQUAL(jm.size(), loaded.size());
+    BOOST_CHECK_EQUAL(-99, *loaded.get(99 * 99));
+    BOOST_CHECK_EQUAL(0, *loaded.get(0));
+
+    std::istringstream set_data("JUDYPPs\1");
+    BOOST_CHECK_EQUAL(false, loaded.load(set_data));
+    BOOST_CHECK_EQUAL(jm.size(), loaded.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_load_narrow)
+{
+    // keys out of the range of the key type are rejected
+    judypp::Set<unsigned long> wide;
+    wide.set(200);
+    wide.set(1000);
+    std::stringstream ss;
+    BOOST_CHECK_EQUAL(true, wide.save(ss));
+    judypp::Set<uint8_t> narrow;
+    narrow.set(1);
+    BOOST_CHECK_EQUAL(false, narrow.load(ss));
+    BOOST_CHECK_EQUAL(1u, narrow.size());
+    BOOST_CHECK_EQUAL(true, narrow.test(1));
+
+    // negative keys of long do not fit int
+    judypp::Map<long, int> jm;
+    jm.put(-5) = 1;
+    jm.put(1L << 40) = 2;
+    std::stringstream ms;
+    BOOST_CHECK_EQUAL(true, jm.save(ms));
+    judypp::Map<int, int> mi;
+    BOOST_CHECK_EQUAL(false, mi.load(ms));
+    BOOST_CHECK_EQUAL(true, mi.empty());
+
+    // keys which fit are loaded
+    jm.del(1L << 40);
+    std::stringstream fs;
+    BOOST_CHECK_EQUAL(true, jm.save(fs));
+    BOOST_CHECK_EQUAL(true, mi.load(fs));
+    BOOST_CHECK_EQUAL(1, *mi.get(-5));
+}
+
+BOOST_AUTO_TEST_CASE(test_save_short_write)
+{
+    judypp::Set<long> js;
+    judypp::Map<unsigned long, int> jm;
+    for (long i = 0; i < 1000; ++i)
+    {
+        js.set(i * 3);
+        jm.put(i * 3) = i;
+    }
+
+    for (std::streamsize limit : {0, 5, 100})
+    {
+        limited_buf sb(limit);
+        std::ostream os(&sb);
+        BOOST_CHECK_EQUAL(false, js.save(os));
+        BOOST_CHECK_EQUAL(true, os.bad());
+
+        limited_buf mb(limit);
+        std::ostream mos(&mb);
+        BOOST_CHECK_EQUAL(false, jm.save(mos));
+        BOOST_CHECK_EQUAL(true, mos.bad());
+    }
+
+    limited_buf enough(1 << 20);
+    std::ostream os(&enough);
+    BOOST_CHECK_EQUAL(true, js.save(os));
+}
+
+BOOST_AUTO_TEST_CASE(test_frozen)
+{
+    judypp::Set<int> js;
+    judypp::Map<int, short> jm;
+    for (int i = -500; i < 500; i += 3)
+    {
+        js.set(i);
+        jm.put(i) = i / 3;
+    }
+
+    char path[] = "/tmp/judypp_frozen_XXXXXX";
+    const int fd = mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+
+    {
+        std::ofstream os(path, std::ios::binary);
+        BOOST_CHECK_EQUAL(true, judypp::save_frozen(js, os));
+    }
+    judypp::MappedFile file;
+    BOOST_REQUIRE(file.open(path));
+    judypp::FrozenSet<int> fs;
+    BOOST_REQUIRE(fs.open(file.data(), file.size()));
+    BOOST_CHECK_EQUAL(js.size(), fs.size());
+    BOOST_CHECK_EQUAL(true, fs.test(-500));
+    BOOST_CHECK_EQUAL(true, fs.test(1));
+    BOOST_CHECK_EQUAL(false, fs.test(2));
+    BOOST_CHECK(std::equal(js.begin(), js.end(), fs.begin()));
+    BOOST_CHECK_EQUAL(4, *fs.lower_bound(2));
+    BOOST_CHECK_EQUAL(4, *fs.upper_bound(1));
+    BOOST_CHECK(fs.find(1000) == fs.end());
+    BOOST_CHECK_EQUAL(499, *--fs.end());
+
+    // the format of a set is not a map
+    judypp::FrozenMap<int, short> fm;
+    BOOST_CHECK_EQUAL(false, fm.open(file.data(), file.size()));
+    BOOST_CHECK_EQUAL(false, fs.open(file.data(), file.size() / 2));
+
+    {
+        std::ofstream os(path, std::ios::binary);
+        BOOST_CHECK_EQUAL(true, judypp::save_frozen(jm, os));
+    }
+    BOOST_REQUIRE(file.open(path));
+    BOOST_REQUIRE(fm.open(file.data(), file.size()));
+    BOOST_CHECK_EQUAL(jm.size(), fm.size());
+    BOOST_REQUIRE(NULL != fm.get(-5));
+    BOOST_CHECK_EQUAL(-1, *fm.get(-5));
+    BOOST_CHECK(NULL == fm.get(-4));
+    BOOST_CHECK_EQUAL(1, fm.find(4)->second);
+    int n = 0;
+    for (auto x : fm)
+        n += x.second == *jm.get(x.first);
+    BOOST_CHECK_EQUAL(jm.size(), size_t(n));
+
+    file.close();
+    unlink(path);
+    BOOST_CHECK_EQUAL(false, file.open(path));
+}
+
+BOOST_AUTO_TEST_CASE(test_freeze)
+{
+    // all shapes of the tree up to 200 keys against the mutable set
+    for (long n = 0; n <= 200; ++n)
+    {
+        judypp::Set<long> js;
+        std::set<long> ref;
+        for (long i = 0; i < n; ++i)
+        {
+            js.set(i * 4 - 100);
+            ref.insert(i * 4 - 100);
+        }
+        const judypp::FrozenSet<long> fs = js.freeze();
+        BOOST_REQUIRE_EQUAL(js.size(), fs.size());
+        BOOST_REQUIRE(std::vector<long>(js.begin(), js.end()) == std::vector<long>(fs.begin(), fs.end()));
+
+        std::vector<long> back;
+        for (auto it = fs.end(); it != fs.begin();)
+            back.push_back(*--it);
+        BOOST_REQUIRE(std::vector<long>(js.begin(), js.end()) == std::vector<long>(back.rbegin(), back.rend()));
+
+        for (long k = -105; k < n * 4 - 95; ++k)
+        {
+            BOOST_REQUIRE_EQUAL(js.test(k), fs.test(k));
+            auto l = ref.lower_bound(k);
+            auto fl = fs.lower_bound(k);
+            BOOST_REQUIRE_EQUAL(l == ref.end(), fl == fs.end());
+            if (l != ref.end())
+                BOOST_REQUIRE_EQUAL(*l, *fl);
+            auto u = ref.upper_bound(k);
+            auto fu = fs.upper_bound(k);
+            BOOST_REQUIRE_EQUAL(u == ref.end(), fu == fs.end());
+            if (u != ref.end())
+                BOOST_REQUIRE_EQUAL(*u, *fu);
+        }
+    }
+
+    judypp::Map<unsigned long, int> jm;
+    for (unsigned long i = 0; i < 1000; ++i)
+        jm.put(i * i) = int(i);
+    judypp::FrozenMap<unsigned long, int> fm = jm.freeze();
+    BOOST_CHECK_EQUAL(1000u, fm.size());
+    BOOST_REQUIRE(NULL != fm.get(81));
+    BOOST_CHECK_EQUAL(9, *fm.get(81));
+    BOOST_CHECK(NULL == fm.get(82));
+    BOOST_CHECK_EQUAL(10, fm.upper_bound(81)->second);
+    int n = 0;
+    for (auto x : fm)
+        n += x.second == *jm.get(x.first);
+    BOOST_CHECK_EQUAL(1000, n);
+
+    // the own image is copied deeply and kept by moves
+    BOOST_CHECK_LT(16000u, fm.memory_usage());
+    judypp::FrozenMap<unsigned long, int> copy(fm);
+    judypp::FrozenMap<unsigned long, int> moved(std::move(fm));
+    BOOST_CHECK_EQUAL(true, fm.empty());
+    jm.clear();
+    BOOST_CHECK_EQUAL(999, *copy.get(999 * 999));
+    BOOST_CHECK_EQUAL(999, *moved.get(999 * 999));
+    copy = judypp::FrozenMap<unsigned long, int>();
+    BOOST_CHECK_EQUAL(true, copy.empty());
+    BOOST_CHECK(copy.begin() == copy.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
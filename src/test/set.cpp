@@ -20,9 +20,12 @@
  */
 
 #include <judypp/set.hpp>
+#include <algorithm>
 #include <boost/mpl/list.hpp>
 #include <boost/test/unit_test.hpp>
 #include <limits>
+#include <stdint.h>
+#include <vector>
 
 using namespace boost::unit_test;
 
@@ -71,6 +74,7 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_set, T, set_types_t)
     BOOST_CHECK_EQUAL(true, js.set(T(16)));
     BOOST_CHECK_EQUAL(false, js.empty());
     BOOST_CHECK_EQUAL(7u, js.size());
+    BOOST_CHECK_EQUAL(3u, js.count(T(1), T(16)));
     BOOST_CHECK_EQUAL(true, js.test(T(100)));
     BOOST_CHECK_EQUAL(true, js.erase(T(100)));
     BOOST_CHECK_EQUAL(false, js.test(T(100)));
@@ -152,6 +156,400 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_iters, T, set_types_t)
     BOOST_CHECK(it == ++jit);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_order_stats, T, set_types_t)
+{
+    judypp::Set<T> js;
+    BOOST_CHECK_EQUAL(0u, js.rank(T(10)));
+    BOOST_CHECK(js.select(0) == js.end());
+
+    js.set(T(10));
+    js.set(T(20));
+    js.set(T(30));
+
+    BOOST_CHECK_EQUAL(0u, js.rank(T(5)));
+    BOOST_CHECK_EQUAL(1u, js.rank(T(10)));
+    BOOST_CHECK_EQUAL(2u, js.rank(T(25)));
+    BOOST_CHECK_EQUAL(3u, js.rank(T(30)));
+
+    BOOST_REQUIRE(js.select(0) != js.end());
+    BOOST_CHECK_EQUAL(T(10), *js.select(0));
+    BOOST_CHECK_EQUAL(T(30), *js.select(2));
+    BOOST_CHECK(js.select(3) == js.end());
+    BOOST_CHECK(++js.select(1) == js.select(2));
+
+    BOOST_CHECK_EQUAL(3u, js.count(T(10), T(30)));
+    BOOST_CHECK_EQUAL(2u, js.count(T(11), T(30)));
+    BOOST_CHECK_EQUAL(0u, js.count(T(11), T(19)));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_algebra, T, set_types_t)
+{
+    typedef judypp::Set<T> set_t;
+    std::vector<T> va = {T(1), T(2), T(3), T(10), T(500), T(1000)};
+    std::vector<T> vb = {T(2), T(10), T(11), T(2000)};
+    set_t a, b, e;
+    a.insert(va.begin(), va.end());
+    b.insert(vb.begin(), vb.end());
+
+    std::vector<T> expected = {T(1), T(2), T(3), T(10), T(11), T(500), T(1000), T(2000)};
+    set_t r = judypp::set_union(a, b);
+    BOOST_CHECK_EQUAL(expected.size(), r.size());
+    BOOST_CHECK(std::equal(expected.begin(), expected.end(), r.begin()));
+
+    expected = {T(2), T(10)};
+    r = judypp::set_intersection(a, b);
+    BOOST_CHECK_EQUAL(expected.size(), r.size());
+    BOOST_CHECK(std::equal(expected.begin(), expected.end(), r.begin()));
+
+    expected = {T(1), T(3), T(500), T(1000)};
+    r = judypp::set_difference(a, b);
+    BOOST_CHECK_EQUAL(expected.size(), r.size());
+    BOOST_CHECK(std::equal(expected.begin(), expected.end(), r.begin()));
+
+    expected = {T(1), T(3), T(11), T(500), T(1000), T(2000)};
+    r = judypp::set_symmetric_difference(a, b);
+    BOOST_CHECK_EQUAL(expected.size(), r.size());
+    BOOST_CHECK(std::equal(expected.begin(), expected.end(), r.begin()));
+
+    // with empty set
+    BOOST_CHECK_EQUAL(a.size(), judypp::set_union(a, e).size());
+    BOOST_CHECK_EQUAL(true, judypp::set_intersection(e, a).empty());
+    BOOST_CHECK_EQUAL(a.size(), judypp::set_difference(a, e).size());
+    BOOST_CHECK_EQUAL(true, judypp::set_difference(e, a).empty());
+
+    // in place
+    r = a;
+    r |= b;
+    BOOST_CHECK_EQUAL(8u, r.size());
+    r = a;
+    r &= b;
+    BOOST_CHECK_EQUAL(2u, r.size());
+    BOOST_CHECK_EQUAL(true, r.test(T(10)));
+    r = a;
+    r -= b;
+    BOOST_CHECK_EQUAL(4u, r.size());
+    BOOST_CHECK_EQUAL(false, r.test(T(2)));
+    BOOST_CHECK_EQUAL(true, r.test(T(1000)));
+    r = a;
+    r ^= b;
+    BOOST_CHECK_EQUAL(6u, r.size());
+    BOOST_CHECK_EQUAL(true, r.test(T(2000)));
+    r &= e;
+    BOOST_CHECK_EQUAL(true, r.empty());
+}
+
+typedef boost::mpl::list<char, short, int, long> signed_types_t;
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_signed_order, T, signed_types_t)
+{
+    const T lo = std::numeric_limits<T>::min();
+    const T hi = std::numeric_limits<T>::max();
+    std::vector<T> keys = {lo, T(-100), T(-1), T(0), T(1), T(100), hi};
+
+    judypp::Set<T> js;
+    for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+        js.set(*it);
+    BOOST_CHECK(std::equal(keys.begin(), keys.end(), js.begin()));
+    BOOST_CHECK_EQUAL(lo, *js.begin());
+    BOOST_CHECK_EQUAL(lo, *js.select(0));
+    BOOST_CHECK_EQUAL(T(-1), *js.find(T(-1)));
+
+    BOOST_CHECK_EQUAL(3u, js.rank(T(-1)));
+    BOOST_CHECK_EQUAL(3u, js.count(T(-100), T(0)));
+    BOOST_CHECK_EQUAL(keys.size(), js.count(lo, hi));
+
+    // bulk path takes sorted signed keys
+    judypp::Set<T> bulk;
+    bulk.assign_sorted(keys.begin(), keys.end());
+    BOOST_CHECK_EQUAL(keys.size(), bulk.size());
+    BOOST_CHECK(std::equal(keys.begin(), keys.end(), bulk.begin()));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_bulk, T, set_types_t)
+{
+    std::vector<T> sorted = {T(1), T(2), T(10), T(300), T(65536)};
+    std::vector<T> unsorted = {T(5), T(3), T(5), T(100)};
+
+    judypp::Set<T> js;
+    js.assign_sorted(sorted.begin(), sorted.end());
+    BOOST_CHECK_EQUAL(sorted.size(), js.size());
+    BOOST_CHECK(std::equal(sorted.begin(), sorted.end(), js.begin()));
+
+    // into non-empty set
+    js.insert(unsorted.begin(), unsorted.end());
+    BOOST_CHECK_EQUAL(8u, js.size());
+    BOOST_CHECK_EQUAL(true, js.test(T(3)));
+    BOOST_CHECK_EQUAL(true, js.test(T(10)));
+
+    // assign replaces content, unsorted input takes the slow path
+    js.assign_sorted(unsorted.begin(), unsorted.end());
+    BOOST_CHECK_EQUAL(3u, js.size());
+    BOOST_CHECK_EQUAL(false, js.test(T(10)));
+    BOOST_CHECK_EQUAL(true, js.test(T(5)));
+
+    js.assign_sorted(sorted.end(), sorted.end());
+    BOOST_CHECK_EQUAL(true, js.empty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_test_many, T, set_types_t)
+{
+    judypp::Set<T> js;
+    bool out[8];
+    std::vector<T> keys = {T(0), T(1), T(5), T(10), T(11), T(12), T(100), T(101)};
+    BOOST_CHECK_EQUAL(0u, js.test_many(keys.data(), keys.size(), out));
+    BOOST_CHECK_EQUAL(false, out[0]);
+
+    js.set(T(1));
+    js.set(T(10));
+    js.set(T(12));
+    js.set(T(100));
+
+    // sorted, unsorted and repeated keys give the same as test()
+    for (int pass = 0; pass < 3; ++pass)
+    {
+        size_t found = 0;
+        for (T k : keys)
+            found += js.test(k);
+        BOOST_CHECK_EQUAL(found, js.test_many(keys.data(), keys.size(), out));
+        for (size_t i = 0; i < keys.size(); ++i)
+            BOOST_CHECK_EQUAL(js.test(keys[i]), out[i]);
+        if (0 == pass)
+            std::reverse(keys.begin(), keys.end());
+        else
+            keys = {T(12), T(12), T(0), T(100), T(100), T(11), T(1), T(10)};
+    }
+    BOOST_CHECK_EQUAL(0u, js.test_many(keys.data(), 0, out));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_erase_range, T, set_types_t)
+{
+    judypp::Set<T> js;
+    BOOST_CHECK_EQUAL(0u, js.erase_range(T(0), T(100)));
+    for (long i = 1; i <= 100; ++i)
+        js.set(T(i * 10));
+
+    // few keys one by one, then the most of them by rebuild
+    BOOST_CHECK_EQUAL(0u, js.erase_range(T(11), T(19)));
+    BOOST_CHECK_EQUAL(0u, js.erase_range(T(30), T(20)));
+    BOOST_CHECK_EQUAL(3u, js.erase_range(T(10), T(30)));
+    BOOST_CHECK_EQUAL(97u, js.size());
+    BOOST_CHECK_EQUAL(false, js.test(T(20)));
+    BOOST_CHECK_EQUAL(T(40), *js.begin());
+
+    BOOST_CHECK_EQUAL(90u, js.erase_range(T(41), T(945)));
+    BOOST_CHECK_EQUAL(7u, js.size());
+    BOOST_CHECK_EQUAL(true, js.test(T(40)));
+    BOOST_CHECK_EQUAL(false, js.test(T(50)));
+    BOOST_CHECK_EQUAL(true, js.test(T(950)));
+    BOOST_CHECK_EQUAL(2u, js.count(T(0), T(950)));
+
+    BOOST_CHECK_EQUAL(7u, js.erase_range(T(0), T(1000)));
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK(js.begin() == js.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_for_each, T, set_types_t)
+{
+    judypp::Set<T> js;
+    std::vector<T> keys;
+    // runs of different lengths and single keys
+    for (long i : {1, 2, 3, 4, 5, 6, 7, 10, 12, 13, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 40})
+    {
+        js.set(T(i));
+        keys.push_back(T(i));
+    }
+
+    std::vector<T> visited;
+    for (auto it = js.begin(); it != js.end(); ++it)
+        visited.push_back(*it);
+    BOOST_CHECK(keys == visited);
+
+    visited.clear();
+    js.for_each([&] (T k) { visited.push_back(k); });
+    BOOST_CHECK(keys == visited);
+
+    visited.clear();
+    js.for_each_range(T(3), T(24), [&] (T k) { visited.push_back(k); });
+    BOOST_CHECK(std::vector<T>(keys.begin() + 2, keys.end() - 6) == visited);
+
+    visited.clear();
+    js.for_each_range(T(8), T(9), [&] (T k) { visited.push_back(k); });
+    js.for_each_range(T(30), T(20), [&] (T k) { visited.push_back(k); });
+    BOOST_CHECK(visited.empty());
+
+    // steps back inside the run
+    auto it = js.begin();
+    for (int i = 0; i < 5; ++i)
+        ++it;
+    BOOST_CHECK_EQUAL(T(6), *it);
+    --it;
+    BOOST_CHECK_EQUAL(T(5), *it);
+    ++it;
+    ++it;
+    ++it;
+    BOOST_CHECK_EQUAL(T(10), *it);
+}
+
+BOOST_AUTO_TEST_CASE(test_set_cursor_end)
+{
+    const unsigned long max = std::numeric_limits<unsigned long>::max();
+    judypp::Set<unsigned long> js;
+    for (unsigned long i = 0; i < 6; ++i)
+        js.set(max - i);
+
+    BOOST_CHECK_EQUAL(6, std::distance(js.begin(), js.end()));
+    size_t n = 0;
+    js.for_each_range(max - 2, max, [&] (unsigned long) { ++n; });
+    BOOST_CHECK_EQUAL(3u, n);
+    n = 0;
+    js.for_each([&] (unsigned long) { ++n; });
+    BOOST_CHECK_EQUAL(6u, n);
+}
+
+BOOST_AUTO_TEST_CASE(test_set_erase_ahead)
+{
+    judypp::Set<int> js;
+    for (int i = 0; i < 20; ++i)
+        js.set(i);
+
+    // like std::set iterators do not visit keys erased ahead of them
+    std::vector<int> seen;
+    for (judypp::Set<int>::const_iterator it = js.begin(); it != js.end(); ++it)
+    {
+        seen.push_back(*it);
+        if (5 == *it)
+        {
+            js.erase(8);
+            js.erase(19);
+        }
+    }
+    BOOST_CHECK_EQUAL(18u, seen.size());
+    BOOST_CHECK(std::find(seen.begin(), seen.end(), 8) == seen.end());
+    BOOST_CHECK_EQUAL(18, seen.back());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_copy_keys, T, set_types_t)
+{
+    judypp::Set<T> js;
+    T lo = T(0);
+    T buf[64];
+    std::pair<size_t, bool> r = js.copy_keys(lo, buf, 64);
+    BOOST_CHECK_EQUAL(0u, r.first);
+    BOOST_CHECK_EQUAL(false, r.second);
+
+    std::vector<T> keys;
+    for (long i = 1; i <= 1000; ++i)
+    {
+        // runs and gaps
+        const long k = i + i / 10 * 5;
+        js.set(T(k));
+        keys.push_back(T(k));
+    }
+
+    std::vector<T> copied;
+    size_t chunks = 0;
+    do
+    {
+        r = js.copy_keys(lo, buf, 64);
+        copied.insert(copied.end(), buf, buf + r.first);
+        ++chunks;
+    }
+    while (r.second);
+    BOOST_CHECK(keys == copied);
+    BOOST_CHECK_EQUAL(16u, chunks);
+
+    // exact fit ends with no more keys
+    lo = T(0);
+    std::vector<T> all(1000);
+    r = js.copy_keys(lo, all.data(), all.size());
+    BOOST_CHECK_EQUAL(1000u, r.first);
+    BOOST_CHECK_EQUAL(false, r.second);
+    BOOST_CHECK(keys == all);
+
+    lo = T(10);
+    r = js.copy_keys(lo, buf, 0);
+    BOOST_CHECK_EQUAL(0u, r.first);
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_CHECK_EQUAL(T(15), lo);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_set_bitmap, T, set_types_t)
+{
+    judypp::Set<T> js;
+    for (long i = 0; i < 1000; ++i)
+        if (i % 4 != 3 && (i < 300 || i >= 500))
+            js.set(T(i));
+
+    // [lo, hi] is 300 keys, so 5 words with 44 bits of the last one
+    std::vector<uint64_t> words(6, ~uint64_t(0));
+    BOOST_CHECK_EQUAL(177u, js.to_bitmap(T(64), T(363), words.data()));
+    BOOST_CHECK_EQUAL(uint64_t(0x7777777777777777ull), words[0]);
+    BOOST_CHECK_EQUAL(uint64_t(0x77777777777ull), words[3]);
+    BOOST_CHECK_EQUAL(uint64_t(0), words[4]);
+    BOOST_CHECK_EQUAL(~uint64_t(0), words[5]);
+    BOOST_CHECK_EQUAL(0u, js.to_bitmap(T(10), T(5), words.data()));
+
+    // into the empty set and into the filled one
+    judypp::Set<T> copy;
+    BOOST_CHECK_EQUAL(177u, copy.from_bitmap(T(64), words.data(), 5));
+    BOOST_CHECK_EQUAL(177u, copy.size());
+    BOOST_CHECK_EQUAL(177u, copy.count(T(64), T(363)));
+    BOOST_CHECK_EQUAL(true, copy.test(T(64)));
+    BOOST_CHECK_EQUAL(false, copy.test(T(67)));
+    BOOST_CHECK_EQUAL(true, copy.test(T(298)));
+
+    const uint64_t more[2] = {0x0f, uint64_t(1) << 63};
+    BOOST_CHECK_EQUAL(5u, copy.from_bitmap(T(48), more, 2));
+    BOOST_CHECK_EQUAL(true, copy.test(T(51)));
+    BOOST_CHECK_EQUAL(true, copy.test(T(48 + 127)));
+    BOOST_CHECK_EQUAL(182u, copy.size());
+    BOOST_CHECK_EQUAL(0u, copy.from_bitmap(T(0), more, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_set_bitmap_narrow)
+{
+    // bits past the largest key are dropped by both paths
+    const uint64_t words[2] = {0x3f | uint64_t(1) << 10, 1};
+    judypp::Set<uint8_t> empty;
+    BOOST_CHECK_EQUAL(6u, empty.from_bitmap(250, words, 2));
+    judypp::Set<uint8_t> filled;
+    filled.set(1);
+    BOOST_CHECK_EQUAL(6u, filled.from_bitmap(250, words, 2));
+    BOOST_CHECK_EQUAL(7u, filled.size());
+    BOOST_CHECK_EQUAL(false, filled.test(4));
+    BOOST_CHECK_EQUAL(6u, empty.count(0, 255));
+    BOOST_CHECK_EQUAL(250, int(*empty.begin()));
+
+    judypp::Set<int8_t> js;
+    BOOST_CHECK_EQUAL(6u, js.from_bitmap(120, words, 2));
+    BOOST_CHECK_EQUAL(6u, js.count(-128, 127));
+    BOOST_CHECK_EQUAL(125, int(*js.select(5)));
+}
+
+BOOST_AUTO_TEST_CASE(test_set_build_parallel)
+{
+    std::vector<long> keys;
+    for (long i = -100000; i < 100000; i += 3)
+        keys.push_back(i);
+
+    judypp::Set<long> js;
+    js.set(1);
+    js.build_parallel(keys.begin(), keys.end(), 4);
+    BOOST_CHECK_EQUAL(keys.size(), js.size());
+    BOOST_CHECK(std::equal(keys.begin(), keys.end(), js.begin()));
+
+    // unsorted across chunks and inside of them
+    std::swap(keys.front(), keys.back());
+    js.build_parallel(keys.begin(), keys.end(), 4);
+    BOOST_CHECK_EQUAL(keys.size(), js.size());
+    BOOST_CHECK_EQUAL(true, js.test(keys.front()));
+    keys.push_back(keys[1000]);
+    js.build_parallel(keys.begin(), keys.end(), 3);
+    BOOST_CHECK_EQUAL(keys.size() - 1, js.size());
+
+    js.build_parallel(keys.begin(), keys.begin(), 2);
+    BOOST_CHECK_EQUAL(true, js.empty());
+}
+
 BOOST_AUTO_TEST_CASE(test_copy_ctor)
 {
     int NUM_ELEMENTS = 20000000;
@@ -189,4 +587,30 @@ BOOST_AUTO_TEST_CASE(test_copy_optor)
     BOOST_CHECK_EQUAL(index, NUM_ELEMENTS);
 }
 
+BOOST_AUTO_TEST_CASE(test_move)
+{
+    judypp::Set<int> js;
+    js.set(1);
+    js.set(5);
+
+    judypp::Set<int> moved(std::move(js));
+    BOOST_CHECK_EQUAL(2u, moved.size());
+    BOOST_CHECK_EQUAL(true, moved.test(5));
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK(js.begin() == js.end());
+
+    js.set(7);
+    js = std::move(moved);
+    BOOST_CHECK_EQUAL(2u, js.size());
+    BOOST_CHECK_EQUAL(false, js.test(7));
+    BOOST_CHECK_EQUAL(true, moved.empty());
+
+    std::vector<judypp::Set<int> > v(3);
+    v[1] = js;
+    v.resize(100);
+    BOOST_CHECK_EQUAL(2u, v[1].size());
+    BOOST_CHECK_EQUAL(true, v[1].test(1));
+    BOOST_CHECK_EQUAL(2u, js.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
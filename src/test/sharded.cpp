@@ -0,0 +1,210 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#include <judypp/sharded.hpp>
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+BOOST_AUTO_TEST_CASE(test_sharded_set)
+{
+    judypp::ShardedSet<long, 8> js;
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK_EQUAL(true, js.set(5));
+    BOOST_CHECK_EQUAL(false, js.set(5));
+    BOOST_CHECK_EQUAL(true, js.set(-5));
+    BOOST_CHECK_EQUAL(true, js.set(1L << 62));
+    BOOST_CHECK_EQUAL(3u, js.size());
+    BOOST_CHECK_EQUAL(true, js.test(-5));
+    BOOST_CHECK_EQUAL(false, js.test(6));
+    BOOST_CHECK_EQUAL(true, js.unset(5));
+    BOOST_CHECK_EQUAL(false, js.unset(5));
+
+    std::vector<long> keys = {1, -1, 1L << 40, -(1L << 50), 1, 7};
+    BOOST_CHECK_EQUAL(5u, js.set_many(keys.data(), keys.size()));
+    BOOST_CHECK_EQUAL(7u, js.size());
+
+    bool out[6];
+    keys = {1, 2, -5, 1L << 62, 7, 8};
+    BOOST_CHECK_EQUAL(4u, js.test_many(keys.data(), keys.size(), out));
+    BOOST_CHECK_EQUAL(false, out[1]);
+    BOOST_CHECK_EQUAL(true, out[2]);
+
+    // ordered by shards
+    std::vector<long> all;
+    js.for_each([&] (long k) { all.push_back(k); });
+    BOOST_CHECK((std::vector<long>{-(1L << 50), -5, -1, 1, 7, 1L << 40, 1L << 62}) == all);
+
+    js.clear();
+    BOOST_CHECK_EQUAL(true, js.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_sharded_set_low_bits)
+{
+    // dense keys spread by the lowest bits, iteration merges the shards
+    judypp::ShardedSet<unsigned, 4, 0> js;
+    for (unsigned i = 100; i > 0; --i)
+        js.set(i * 3);
+    BOOST_CHECK_EQUAL(100u, js.size());
+    std::vector<unsigned> all;
+    js.for_each([&] (unsigned k) { all.push_back(k); });
+    BOOST_REQUIRE_EQUAL(100u, all.size());
+    for (unsigned i = 0; i < 100; ++i)
+        BOOST_CHECK_EQUAL(3 * (i + 1), all[i]);
+}
+
+BOOST_AUTO_TEST_CASE(test_sharded_set_narrow)
+{
+    // default shift takes the highest bits of 32-bit keys, not of the word
+    judypp::ShardedSet<uint32_t, 4> ju;
+    std::set<const void*> shards;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        const uint32_t k = i << 30 | 5;
+        ju.set(k);
+        shards.insert(ju.apply(k, [] (const judypp::Set<uint32_t>& s) { return &s; }));
+    }
+    BOOST_CHECK_EQUAL(4u, shards.size());
+    std::vector<uint32_t> all;
+    ju.for_each([&] (uint32_t k) { all.push_back(k); });
+    BOOST_CHECK((std::vector<uint32_t>{5, 1u << 30 | 5, 2u << 30 | 5, 3u << 30 | 5}) == all);
+
+    // signed keys use all shards and stay ordered
+    judypp::ShardedSet<int32_t, 4> js;
+    std::vector<int32_t> keys = {std::numeric_limits<int32_t>::min(), -(1 << 30), -1, 0, 1 << 30, (1 << 30) + 5};
+    shards.clear();
+    for (int32_t k : keys)
+    {
+        js.set(k);
+        shards.insert(js.apply(k, [] (const judypp::Set<int32_t>& s) { return &s; }));
+    }
+    BOOST_CHECK_EQUAL(4u, shards.size());
+    std::vector<int32_t> sall;
+    js.for_each([&] (int32_t k) { sall.push_back(k); });
+    BOOST_CHECK(keys == sall);
+    js.build_parallel(keys.begin(), keys.end(), 2);
+    BOOST_CHECK_EQUAL(keys.size(), js.size());
+
+    // one shard takes no bits
+    judypp::ShardedMap<unsigned long, int, 1> jm;
+    BOOST_CHECK_EQUAL(true, jm.put(-1ul, 1));
+    BOOST_CHECK_EQUAL(true, jm.put(1, 2));
+    int v = 0;
+    BOOST_CHECK_EQUAL(true, jm.get(-1ul, v));
+    BOOST_CHECK_EQUAL(1, v);
+    BOOST_CHECK_EQUAL(2u, jm.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_sharded_map)
+{
+    judypp::ShardedMap<unsigned long, int, 16, 8> jm;
+    BOOST_CHECK_EQUAL(true, jm.put(1, 10));
+    BOOST_CHECK_EQUAL(false, jm.put(1, 11));
+    int v = 0;
+    BOOST_CHECK_EQUAL(true, jm.get(1, v));
+    BOOST_CHECK_EQUAL(11, v);
+    BOOST_CHECK_EQUAL(false, jm.get(2, v));
+
+    std::vector<unsigned long> keys = {256, 512, 1, 100000};
+    std::vector<int> values = {1, 2, 3, 4};
+    BOOST_CHECK_EQUAL(3u, jm.put_many(keys.data(), values.data(), keys.size()));
+    BOOST_CHECK_EQUAL(4u, jm.size());
+
+    keys.push_back(7);
+    int out[5];
+    bool found[5];
+    BOOST_CHECK_EQUAL(4u, jm.get_many(keys.data(), keys.size(), out, found));
+    BOOST_CHECK_EQUAL(3, out[2]);
+    BOOST_CHECK_EQUAL(false, found[4]);
+
+    std::vector<unsigned long> all;
+    jm.for_each([&] (std::pair<const unsigned long, const int&> x) { all.push_back(x.first); });
+    BOOST_CHECK((std::vector<unsigned long>{1, 256, 512, 100000}) == all);
+
+    BOOST_CHECK_EQUAL(true, jm.del(256));
+    BOOST_CHECK_EQUAL(3u, jm.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_sharded_threads)
+{
+    judypp::ShardedSet<unsigned long, 16, 4> js;
+    std::vector<std::thread> writers;
+    for (unsigned long t = 0; t < 4; ++t)
+        writers.emplace_back([&js, t]
+                {
+                    std::vector<unsigned long> batch;
+                    for (unsigned long i = 0; i < 10000; ++i)
+                    {
+                        // a half of the keys is shared with the next thread
+                        batch.push_back(i % 2 ? t * 10000 + i : ((t + 1) % 4) * 10000 + i);
+                        if (100 == batch.size())
+                        {
+                            js.set_many(batch.data(), batch.size());
+                            batch.clear();
+                        }
+                    }
+                });
+    for (auto& w : writers)
+        w.join();
+    BOOST_CHECK_EQUAL(40000u, js.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_sharded_build_parallel)
+{
+    std::vector<long> keys;
+    for (long i = -(1L << 62); i < (1L << 62); i += 1L << 45)
+        keys.push_back(i);
+
+    judypp::ShardedSet<long, 16> js;
+    js.set(3);
+    js.build_parallel(keys.begin(), keys.end(), 4);
+    BOOST_CHECK_EQUAL(keys.size(), js.size());
+    std::vector<long> all;
+    js.for_each([&] (long k) { all.push_back(k); });
+    BOOST_CHECK(keys == all);
+
+    // unsorted input and shards by low bits are distributed by buckets
+    std::reverse(keys.begin(), keys.end());
+    js.build_parallel(keys.begin(), keys.end(), 4);
+    BOOST_CHECK_EQUAL(keys.size(), js.size());
+    BOOST_CHECK_EQUAL(true, js.test(keys[100]));
+
+    judypp::ShardedSet<long, 4, 0> jl;
+    std::vector<long> dense = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    jl.build_parallel(dense.begin(), dense.end(), 2);
+    BOOST_CHECK_EQUAL(9u, jl.size());
+    BOOST_CHECK_EQUAL(true, jl.test(6));
+
+    jl.clear_parallel(3);
+    BOOST_CHECK_EQUAL(true, jl.empty());
+    js.clear_deferred();
+    BOOST_CHECK_EQUAL(true, js.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
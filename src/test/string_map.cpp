@@ -0,0 +1,199 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#include <judypp/string_map.hpp>
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using namespace boost::unit_test;
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+static const void* np = NULL;
+
+BOOST_AUTO_TEST_CASE(test_string_map)
+{
+    judypp::StringMap<int> js;
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK(js.begin() == js.end());
+    BOOST_CHECK_EQUAL(np, js.get("a"));
+
+    js.put("b") = 2;
+    js.put(std::string("a")) = 1;
+    js["abc"] = 3;
+    js["b"] = 4;
+    BOOST_CHECK_EQUAL(3u, js.size());
+    BOOST_REQUIRE_NE(np, js.get("abc"));
+    BOOST_CHECK_EQUAL(3, *js.get("abc"));
+    BOOST_CHECK_EQUAL(4, *js.get("b"));
+    BOOST_CHECK_EQUAL(np, js.get("ab"));
+
+    // lookup by the part of a bigger string
+    const std::string text = "abcdef";
+    BOOST_CHECK_EQUAL(3, *js.get(judypp::string_key(text.data(), 3)));
+
+    // long keys
+    const std::string long_key(1000, 'x');
+    js[long_key] = 5;
+    BOOST_CHECK_EQUAL(5, *js.get(long_key));
+
+    BOOST_CHECK_EQUAL(false, js.insert(std::make_pair(judypp::string_key("a"), 10)).second);
+    BOOST_CHECK_EQUAL(1, *js.get("a"));
+    auto r = js.insert(std::make_pair(judypp::string_key("c"), 10));
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_CHECK_EQUAL("c", r.first->first);
+    BOOST_CHECK_EQUAL(5u, js.size());
+
+    std::vector<std::string> keys;
+    for (auto x : js)
+        keys.push_back(x.first.to_string());
+    BOOST_CHECK((std::vector<std::string>{"a", "abc", "b", "c", long_key}) == keys);
+
+    auto it = js.end();
+    --it;
+    BOOST_CHECK_EQUAL(long_key, (*it).first);
+    --it;
+    BOOST_CHECK_EQUAL("c", (*it).first);
+
+    BOOST_CHECK_EQUAL("abc", js.lower_bound("ab")->first);
+    BOOST_CHECK_EQUAL("b", js.upper_bound("abc")->first);
+    BOOST_CHECK(js.find("ab") == js.end());
+    BOOST_CHECK_EQUAL(3, js.find("abc")->second);
+
+    BOOST_CHECK_EQUAL(1u, js.erase("abc"));
+    BOOST_CHECK_EQUAL(0u, js.erase("abc"));
+    BOOST_CHECK_EQUAL(4u, js.size());
+
+    judypp::StringMap<int> copy(js);
+    js.clear();
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK_EQUAL(4u, copy.size());
+    BOOST_CHECK_EQUAL(5, *copy.get(long_key));
+}
+
+BOOST_AUTO_TEST_CASE(test_string_map_prefix)
+{
+    judypp::StringMap<int> js;
+    for (const char* k : {"metric", "metric.cpu", "metric.mem", "metricz", "tenant.a", "\xff", "\xff\xff"})
+        js.put(k) = 1;
+
+    std::vector<std::string> keys;
+    auto r = js.prefix_range("metric.");
+    for (auto it = r.first; it != r.second; ++it)
+        keys.push_back((*it).first.to_string());
+    BOOST_CHECK((std::vector<std::string>{"metric.cpu", "metric.mem"}) == keys);
+
+    r = js.prefix_range("metric");
+    BOOST_CHECK_EQUAL(4, std::distance(r.first, r.second));
+    r = js.prefix_range("x");
+    BOOST_CHECK(r.first == r.second);
+    r = js.prefix_range("\xff");
+    BOOST_CHECK_EQUAL(2, std::distance(r.first, r.second));
+    r = js.prefix_range("");
+    BOOST_CHECK_EQUAL(js.size(), size_t(std::distance(r.first, r.second)));
+}
+
+BOOST_AUTO_TEST_CASE(test_string_set)
+{
+    judypp::StringSet js;
+    BOOST_CHECK_EQUAL(true, js.set("b"));
+    BOOST_CHECK_EQUAL(true, js.set("a"));
+    BOOST_CHECK_EQUAL(false, js.set("b"));
+    BOOST_CHECK_EQUAL(2u, js.size());
+    BOOST_CHECK_EQUAL(true, js.test("a"));
+    BOOST_CHECK_EQUAL(false, js.test("c"));
+
+    std::vector<std::string> keys;
+    for (auto k : js)
+        keys.push_back(k.to_string());
+    BOOST_CHECK((std::vector<std::string>{"a", "b"}) == keys);
+    BOOST_CHECK_EQUAL("b", *js.find("b"));
+
+    BOOST_CHECK_EQUAL(true, js.unset("a"));
+    BOOST_CHECK_EQUAL(false, js.test("a"));
+    BOOST_CHECK_EQUAL(1u, js.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_hash_map)
+{
+    judypp::HashMap<long> js;
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK_EQUAL(np, js.get("a"));
+
+    // keys are byte strings and may contain zeros
+    const std::string k1("a\0b", 3), k2("a\0c", 3);
+    js.put(k1) = 1;
+    js[k2] = 2;
+    js["a"] = 3;
+    js.put(k1) = 4;
+    BOOST_CHECK_EQUAL(3u, js.size());
+    BOOST_CHECK_EQUAL(4, *js.get(k1));
+    BOOST_CHECK_EQUAL(2, *js.get(k2));
+    BOOST_CHECK_EQUAL(3, *js.get("a"));
+    BOOST_CHECK_EQUAL(np, js.get("b"));
+
+    BOOST_CHECK_EQUAL(1u, js.erase(k1));
+    BOOST_CHECK_EQUAL(0u, js.erase(k1));
+    BOOST_CHECK_EQUAL(2u, js.size());
+
+    judypp::HashMap<long> moved(std::move(js));
+    BOOST_CHECK_EQUAL(true, js.empty());
+    BOOST_CHECK_EQUAL(2, *moved.get(k2));
+}
+
+BOOST_AUTO_TEST_CASE(test_string_map_zero_values)
+{
+    // present keys with zero values are not taken for new ones
+    judypp::StringMap<int> jn;
+    judypp::StringMap<long> jw;
+    judypp::HashMap<int> hn;
+    judypp::HashMap<long> hw;
+    for (int i = 0; i < 2; ++i)
+    {
+        jn.put("a");
+        jw.put("a");
+        hn.put("a");
+        hw.put("a");
+        jn["b"] = -1;
+        hn["b"] = -1;
+    }
+    BOOST_CHECK_EQUAL(2u, jn.size());
+    BOOST_CHECK_EQUAL(1u, jw.size());
+    BOOST_CHECK_EQUAL(2u, hn.size());
+    BOOST_CHECK_EQUAL(1u, hw.size());
+    BOOST_CHECK_EQUAL(0, *jn.get("a"));
+    BOOST_CHECK_EQUAL(-1, *jn.get("b"));
+    BOOST_CHECK_EQUAL(-1, *hn.get("b"));
+    BOOST_CHECK_EQUAL(false, jn.insert(std::make_pair(judypp::string_key("a"), 5)).second);
+    BOOST_CHECK_EQUAL(false, jw.insert(std::make_pair(judypp::string_key("a"), 5L)).second);
+    BOOST_CHECK_EQUAL(0, jn.begin()->second);
+
+    // removed keys are new again
+    BOOST_CHECK_EQUAL(true, jn.del("a"));
+    BOOST_CHECK_EQUAL(true, hn.del("a"));
+    jn.put("a");
+    hn.put("a");
+    BOOST_CHECK_EQUAL(2u, jn.size());
+    BOOST_CHECK_EQUAL(2u, hn.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,248 @@
+/*
+ * judypp - C++ bindings for the Judy library.
+ * Copyright (C) 2012 Valeriy Bykov <valery.bickov@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Judy:   http://judy.sourceforge.net/
+ * judypp: https://github.com/vozbu/judypp
+ */
+
+#include <judypp/wide_map.hpp>
+#include <boost/test/unit_test.hpp>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+using namespace boost::unit_test;
+
+namespace
+{
+    struct object_key
+    {
+        uint64_t tenant;
+        uint64_t object;
+    };
+
+    struct small_key
+    {
+        uint32_t a;
+        uint8_t b;
+    };
+
+    struct padded_key
+    {
+        uint32_t a;
+        uint64_t b;
+    };
+}
+
+namespace judypp
+{
+    // keys with padding are given by fields
+    template <>
+    struct wide_key_traits<small_key>
+    {
+        static const size_t N = 1;
+        static void encode(const small_key& k, Word_t* w) { w[0] = Word_t(k.a) << 8 | k.b; }
+        static small_key decode(const Word_t* w) { return small_key{uint32_t(w[0] >> 8), uint8_t(w[0])}; }
+    };
+
+    template <>
+    struct wide_key_traits<padded_key>
+    {
+        static const size_t N = 2;
+        static void encode(const padded_key& k, Word_t* w) { w[0] = k.a; w[1] = k.b; }
+        static padded_key decode(const Word_t* w) { return padded_key{uint32_t(w[0]), w[1]}; }
+    };
+}
+
+BOOST_AUTO_TEST_SUITE(judypp)
+
+static const void* np = NULL;
+
+BOOST_AUTO_TEST_CASE(test_wide_map)
+{
+    judypp::WideMap<object_key, int> jm;
+    BOOST_CHECK_EQUAL(true, jm.empty());
+    BOOST_CHECK(jm.begin() == jm.end());
+    BOOST_CHECK_EQUAL(np, jm.get(object_key{1, 2}));
+
+    jm.put(object_key{2, 1}) = 21;
+    jm.put(object_key{1, 2}) = 12;
+    jm[object_key{1, 1}] = 11;
+    jm[object_key{1, 2}] = 120;
+    BOOST_CHECK_EQUAL(3u, jm.size());
+    BOOST_REQUIRE_NE(np, jm.get(object_key{1, 2}));
+    BOOST_CHECK_EQUAL(120, *jm.get(object_key{1, 2}));
+    BOOST_CHECK_EQUAL(np, jm.get(object_key{2, 2}));
+    BOOST_CHECK_EQUAL(np, jm.get(object_key{3, 1}));
+
+    BOOST_CHECK_EQUAL(false, jm.insert(std::make_pair(object_key{1, 1}, 0)).second);
+    BOOST_CHECK_EQUAL(11, *jm.get(object_key{1, 1}));
+    auto r = jm.insert(std::make_pair(object_key{0, -1ul}, 1));
+    BOOST_CHECK_EQUAL(true, r.second);
+    BOOST_CHECK_EQUAL(0u, r.first->first.tenant);
+    BOOST_CHECK_EQUAL(1, r.first->second);
+    BOOST_CHECK_EQUAL(4u, jm.size());
+
+    // lexicographic order by fields
+    std::vector<std::pair<uint64_t, uint64_t> > keys;
+    for (auto x : jm)
+        keys.push_back(std::make_pair(x.first.tenant, x.first.object));
+    BOOST_CHECK((std::vector<std::pair<uint64_t, uint64_t> >{{0, -1ul}, {1, 1}, {1, 2}, {2, 1}}) == keys);
+
+    auto it = jm.end();
+    --it;
+    BOOST_CHECK_EQUAL(2u, it->first.tenant);
+    --it;
+    --it;
+    BOOST_CHECK_EQUAL(1u, it->first.object);
+    --it;
+    BOOST_CHECK(it == jm.begin());
+
+    BOOST_CHECK(jm.find(object_key{2, 2}) == jm.end());
+    BOOST_CHECK_EQUAL(12 * 10, jm.find(object_key{1, 2})->second);
+    BOOST_CHECK_EQUAL(2u, jm.lower_bound(object_key{1, 2})->first.object);
+    BOOST_CHECK_EQUAL(2u, jm.upper_bound(object_key{1, 2})->first.tenant);
+    BOOST_CHECK_EQUAL(-1ul, jm.lower_bound(object_key{0, 0})->first.object);
+    BOOST_CHECK_EQUAL(1u, jm.upper_bound(object_key{0, -1ul})->first.tenant);
+    BOOST_CHECK(jm.lower_bound(object_key{2, 2}) == jm.end());
+
+    // removing the last key of a tenant removes the inner level
+    BOOST_CHECK_EQUAL(false, jm.del(object_key{2, 2}));
+    BOOST_CHECK_EQUAL(true, jm.del(object_key{2, 1}));
+    BOOST_CHECK_EQUAL(1u, jm.erase(object_key{0, -1ul}));
+    BOOST_CHECK_EQUAL(2u, jm.size());
+    BOOST_CHECK_EQUAL(1u, jm.begin()->first.tenant);
+
+    judypp::WideMap<object_key, int> copy(jm);
+    jm.clear();
+    BOOST_CHECK_EQUAL(true, jm.empty());
+    BOOST_CHECK(jm.begin() == jm.end());
+    BOOST_CHECK_EQUAL(2u, copy.size());
+    BOOST_CHECK_EQUAL(11, *copy.get(object_key{1, 1}));
+
+    jm = std::move(copy);
+    BOOST_CHECK_EQUAL(2u, jm.size());
+    BOOST_CHECK_EQUAL(true, copy.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_wide_map_prefix)
+{
+    judypp::WideMap<object_key, int> jm;
+    for (uint64_t t = 1; t <= 3; ++t)
+        for (uint64_t o = 0; o < 10; ++o)
+            jm[object_key{t, o}] = t * 100 + o;
+    jm[object_key{-1ul, 5}] = 1;
+
+    auto r = jm.prefix_range(object_key{2, 7}, 1);
+    int n = 0;
+    for (auto it = r.first; it != r.second; ++it, ++n)
+        BOOST_CHECK_EQUAL(200 + n, it->second);
+    BOOST_CHECK_EQUAL(10, n);
+
+    // the prefix of max words runs to the end
+    r = jm.prefix_range(object_key{-1ul, 0}, 1);
+    BOOST_CHECK_EQUAL(5u, r.first->first.object);
+    BOOST_CHECK(r.second == jm.end());
+
+    r = jm.prefix_range(object_key{4, 0}, 1);
+    BOOST_CHECK(r.first == r.second);
+
+    // full prefix is the key itself
+    r = jm.prefix_range(object_key{3, 3}, 2);
+    BOOST_CHECK_EQUAL(303, r.first->second);
+    BOOST_CHECK(++r.first == r.second);
+
+    // empty prefix is everything
+    r = jm.prefix_range(object_key{3, 3}, 0);
+    BOOST_CHECK(r.first == jm.begin());
+    BOOST_CHECK(r.second == jm.end());
+
+    // more words than the key has are the whole key
+    r = jm.prefix_range(object_key{3, 3}, 5);
+    BOOST_CHECK_EQUAL(303, r.first->second);
+    BOOST_CHECK(++r.first == r.second);
+    r = jm.prefix_range(object_key{-1ul, 5}, 2);
+    BOOST_CHECK_EQUAL(1, r.first->second);
+    BOOST_CHECK(r.second == jm.end());
+    r = jm.prefix_range(object_key{3, 4}, 2);
+    BOOST_CHECK_EQUAL(304, r.first->second);
+    BOOST_CHECK_EQUAL(305, r.second->second);
+}
+
+BOOST_AUTO_TEST_CASE(test_wide_map_small_key)
+{
+    // keys of one word work like Map
+    judypp::WideMap<small_key, long> jm;
+    small_key k;
+    memset(&k, 0, sizeof(k));
+    for (k.a = 0; k.a < 100; ++k.a)
+        jm[k] = k.a;
+    BOOST_CHECK_EQUAL(100u, jm.size());
+    long sum = 0;
+    for (auto x : jm)
+        sum += x.second;
+    BOOST_CHECK_EQUAL(4950, sum);
+    for (k.a = 0; k.a < 100; ++k.a)
+        BOOST_CHECK(jm.del(k));
+    BOOST_CHECK_EQUAL(true, jm.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_wide_map_padding)
+{
+    judypp::WideMap<padded_key, int> jm;
+    padded_key k1, k2;
+    memset(&k1, 0, sizeof(k1));
+    memset(&k2, 0xff, sizeof(k2));
+    k1.a = k2.a = 7;
+    k1.b = k2.b = 9;
+    jm[k1] = 1;
+    jm[k2] = 2;
+    BOOST_CHECK_EQUAL(1u, jm.size());
+    BOOST_REQUIRE(NULL != jm.get(k1));
+    BOOST_CHECK_EQUAL(2, *jm.get(k1));
+    BOOST_CHECK_EQUAL(7u, jm.begin()->first.a);
+    BOOST_CHECK_EQUAL(9u, jm.begin()->first.b);
+}
+
+BOOST_AUTO_TEST_CASE(test_wide_map_int128)
+{
+    // 128-bit keys are ordered by value
+    judypp::WideMap<unsigned __int128, int> ju;
+    const unsigned __int128 high = (unsigned __int128)1 << 64;
+    ju[high] = 1;
+    ju[5] = 0;
+    ju[high + 3] = 2;
+    ju[~(unsigned __int128)0] = 3;
+    int n = 0;
+    for (auto x : ju)
+        BOOST_CHECK_EQUAL(n++, x.second);
+    BOOST_CHECK_EQUAL(4, n);
+    BOOST_CHECK(high + 3 == ju.lower_bound(high + 1)->first);
+
+    judypp::WideMap<__int128, int> js;
+    js[-high] = 0;
+    js[-1] = 1;
+    js[0] = 2;
+    js[high] = 3;
+    n = 0;
+    for (auto x : js)
+        BOOST_CHECK_EQUAL(n++, x.second);
+    BOOST_CHECK_EQUAL(4, n);
+    BOOST_CHECK(-1 == (++js.begin())->first);
+}
+
+BOOST_AUTO_TEST_SUITE_END()